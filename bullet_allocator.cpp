@@ -0,0 +1,158 @@
+// bullet_allocator.cpp
+// Size-class pools and the btAlignedAlloc hooks.
+
+#include "bullet_allocator.h"
+
+#include <LinearMath/btAlignedAllocator.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+
+namespace {
+
+// Sits in front of every block. Pooled blocks keep their class here; malloc
+// blocks also keep where the malloc'd range starts.
+struct BlockHeader {
+    uint32_t sizeClass;
+    uint32_t mallocOffset;  // user pointer - malloc pointer, malloc class only
+    uint64_t size;          // requested bytes
+};
+const size_t kHeaderSize = 16;
+static_assert(sizeof(BlockHeader) == kHeaderSize, "block header must keep 16-byte alignment");
+
+// Pooled blocks are aligned to this (malloc and the headers are 16 bytes, the
+// classes are multiples of 16); stricter requests go to malloc.
+const size_t kPoolAlignment = 16;
+const uint32_t kMallocClass = kBulletSizeClassCount;
+
+struct FreeBlock {
+    FreeBlock* next;
+};
+
+struct SizeClassPool {
+    std::mutex mutex;
+    FreeBlock* freeList = nullptr;
+    BulletSizeClassStats stats;
+};
+
+// Plain static storage that is never torn down (see installBulletAllocator).
+SizeClassPool pools[kBulletSizeClassCount + 1];
+std::atomic<uint64_t> allocationCount(0);
+
+uint32_t sizeClassFor(size_t size, size_t alignment) {
+    if (alignment > kPoolAlignment)
+        return kMallocClass;
+    for (uint32_t i = 0; i < kBulletSizeClassCount; ++i) {
+        if (size <= kBulletSizeClasses[i])
+            return i;
+    }
+    return kMallocClass;
+}
+
+// Carves a new slab into blocks of the class and threads them onto its free
+// list. Called with the pool locked.
+bool growPool(SizeClassPool& pool, uint32_t sizeClass) {
+    unsigned char* slab = static_cast<unsigned char*>(std::malloc(kBulletSlabSize));
+    if (!slab)
+        return false;
+    const size_t stride = kHeaderSize + kBulletSizeClasses[sizeClass];
+    for (size_t offset = 0; offset + stride <= kBulletSlabSize; offset += stride) {
+        BlockHeader* header = reinterpret_cast<BlockHeader*>(slab + offset);
+        header->sizeClass = sizeClass;
+        header->mallocOffset = 0;
+        header->size = 0;
+        FreeBlock* block = reinterpret_cast<FreeBlock*>(slab + offset + kHeaderSize);
+        block->next = pool.freeList;
+        pool.freeList = block;
+    }
+    pool.stats.reservedBytes += kBulletSlabSize;
+    return true;
+}
+
+void* allocateBlock(size_t size, size_t alignment) {
+    alignment = alignment < kPoolAlignment ? kPoolAlignment : alignment;
+    const uint32_t sizeClass = sizeClassFor(size, alignment);
+    SizeClassPool& pool = pools[sizeClass];
+    unsigned char* block = nullptr;
+    if (sizeClass == kMallocClass) {
+        unsigned char* raw = static_cast<unsigned char*>(std::malloc(size + kHeaderSize + alignment));
+        if (!raw)
+            return nullptr;
+        const uintptr_t first = reinterpret_cast<uintptr_t>(raw) + kHeaderSize;
+        block = reinterpret_cast<unsigned char*>((first + alignment - 1) / alignment * alignment);
+        BlockHeader* header = reinterpret_cast<BlockHeader*>(block - kHeaderSize);
+        header->sizeClass = kMallocClass;
+        header->mallocOffset = static_cast<uint32_t>(block - raw);
+    }
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    if (sizeClass == kMallocClass) {
+        pool.stats.reservedBytes += reinterpret_cast<BlockHeader*>(block - kHeaderSize)->mallocOffset + size;
+    } else {
+        if (!pool.freeList && !growPool(pool, sizeClass))
+            return nullptr;
+        block = reinterpret_cast<unsigned char*>(pool.freeList);
+        pool.freeList = pool.freeList->next;
+    }
+    reinterpret_cast<BlockHeader*>(block - kHeaderSize)->size = size;
+    ++pool.stats.liveBlocks;
+    pool.stats.liveBytes += size;
+    ++pool.stats.allocations;
+    ++allocationCount;
+    return block;
+}
+
+void freeBlock(void* pointer) {
+    if (!pointer)
+        return;
+    unsigned char* block = static_cast<unsigned char*>(pointer);
+    BlockHeader* header = reinterpret_cast<BlockHeader*>(block - kHeaderSize);
+    SizeClassPool& pool = pools[header->sizeClass];
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    --pool.stats.liveBlocks;
+    pool.stats.liveBytes -= static_cast<size_t>(header->size);
+    if (header->sizeClass == kMallocClass) {
+        pool.stats.reservedBytes -= header->mallocOffset + static_cast<size_t>(header->size);
+        std::free(block - header->mallocOffset);
+        return;
+    }
+    FreeBlock* free = reinterpret_cast<FreeBlock*>(block);
+    free->next = pool.freeList;
+    pool.freeList = free;
+}
+
+void* bulletAlignedAlloc(size_t size, int alignment) {
+    return allocateBlock(size, alignment > 0 ? static_cast<size_t>(alignment) : kPoolAlignment);
+}
+
+void* bulletAlloc(size_t size) {
+    return allocateBlock(size, kPoolAlignment);
+}
+
+} // namespace
+
+void installBulletAllocator() {
+    btAlignedAllocSetCustom(bulletAlloc, freeBlock);
+    btAlignedAllocSetCustomAligned(bulletAlignedAlloc, freeBlock);
+}
+
+BulletAllocatorStats getBulletAllocatorStats() {
+    BulletAllocatorStats stats;
+    for (int i = 0; i <= kBulletSizeClassCount; ++i) {
+        {
+            std::lock_guard<std::mutex> lock(pools[i].mutex);
+            stats.classes[i] = pools[i].stats;
+        }
+        BulletSizeClassStats& sizeClass = stats.classes[i];
+        sizeClass.size = i < kBulletSizeClassCount ? kBulletSizeClasses[i] : 0;
+        stats.liveBlocks += sizeClass.liveBlocks;
+        stats.liveBytes += sizeClass.liveBytes;
+        stats.reservedBytes += sizeClass.reservedBytes;
+        stats.allocations += sizeClass.allocations;
+    }
+    return stats;
+}
+
+uint64_t bulletAllocationCount() {
+    return allocationCount.load();
+}
@@ -0,0 +1,48 @@
+// bullet_allocator.h
+// Allocation hooks for Bullet. Every btAlignedAlloc goes through here: small
+// blocks (manifolds, broadphase proxies, collision algorithms, motion states)
+// come from per-size-class free lists carved out of 64 KB slabs, larger ones
+// from malloc. Live bytes, live blocks and allocation counts are tracked per
+// class, so the editor can show what the physics world holds and headless
+// runs can check that a settled scene stops allocating.
+
+#ifndef BULLET_ALLOCATOR_H
+#define BULLET_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Block sizes of the pooled classes; anything bigger goes to malloc.
+const int kBulletSizeClassCount = 12;
+const size_t kBulletSizeClasses[kBulletSizeClassCount] = {16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024};
+
+// Bytes carved into blocks at a time.
+const size_t kBulletSlabSize = 64 * 1024;
+
+struct BulletSizeClassStats {
+    size_t size = 0;            // block size; 0 for the malloc class
+    size_t liveBlocks = 0;
+    size_t liveBytes = 0;       // requested sizes
+    size_t reservedBytes = 0;   // slabs; for the malloc class, live blocks with headers and padding
+    uint64_t allocations = 0;
+};
+
+struct BulletAllocatorStats {
+    // kBulletSizeClasses in order, then the malloc class.
+    BulletSizeClassStats classes[kBulletSizeClassCount + 1];
+    size_t liveBlocks = 0;
+    size_t liveBytes = 0;
+    size_t reservedBytes = 0;
+    uint64_t allocations = 0;
+};
+
+// Installs the hooks. Call before Bullet allocates anything: memory from the
+// default allocator must never come back through these hooks. Slabs are never
+// returned, so Bullet objects freed during static destruction stay safe.
+void installBulletAllocator();
+
+BulletAllocatorStats getBulletAllocatorStats();
+// Allocations so far, across all classes. Cheaper than the full stats.
+uint64_t bulletAllocationCount();
+
+#endif // BULLET_ALLOCATOR_H
@@ -0,0 +1,122 @@
+// debug_draw.cpp
+// Line batching and single-call submission for BatchedDebugDraw.
+
+#include "debug_draw.h"
+
+#include <cstddef>
+#include <iostream>
+
+namespace {
+
+const float kContactNormalLength = 0.2f;
+
+uint32_t packColor(const btVector3& color) {
+    uint32_t rgba = 0xff000000u;
+    for (int c = 0; c < 3; ++c) {
+        float v = color[c] < 0.0f ? 0.0f : (color[c] > 1.0f ? 1.0f : color[c]);
+        rgba |= static_cast<uint32_t>(v * 255.0f + 0.5f) << (8 * c);
+    }
+    return rgba;
+}
+
+DebugLineVertex makeVertex(const btVector3& p, uint32_t color) {
+    DebugLineVertex v;
+    v.position[0] = p.x();
+    v.position[1] = p.y();
+    v.position[2] = p.z();
+    v.color = color;
+    return v;
+}
+
+} // namespace
+
+BatchedDebugDraw::BatchedDebugDraw()
+    : maxLines(0), droppedLines(0), debugMode(DBG_NoDebug), VAO(0), VBO(0), vboCapacity(0) {
+    setMaxLines(200000);
+}
+
+void BatchedDebugDraw::setup() {
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(DebugLineVertex),
+                          reinterpret_cast<void*>(offsetof(DebugLineVertex, position)));
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(DebugLineVertex),
+                          reinterpret_cast<void*>(offsetof(DebugLineVertex, color)));
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+}
+
+void BatchedDebugDraw::destroy() {
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    VAO = 0;
+    VBO = 0;
+    vboCapacity = 0;
+}
+
+void BatchedDebugDraw::render() {
+    if (vertices.empty())
+        return;
+    GLsizeiptr count = static_cast<GLsizeiptr>(vertices.size());
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    if (count > vboCapacity)
+        vboCapacity = count * 2;
+    // Orphan the previous frame's storage so the driver does not stall on it.
+    glBufferData(GL_ARRAY_BUFFER, vboCapacity * sizeof(DebugLineVertex), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(DebugLineVertex), vertices.data());
+    glBindVertexArray(VAO);
+    glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(count));
+    glBindVertexArray(0);
+}
+
+void BatchedDebugDraw::setMaxLines(size_t lines) {
+    maxLines = lines;
+    // The batch grows as lines come in; a lower cap only trims it and hands
+    // back storage the cap no longer allows.
+    if (vertices.size() > maxLines * 2)
+        vertices.resize(maxLines * 2);
+    if (vertices.capacity() > maxLines * 2)
+        vertices.shrink_to_fit();
+}
+
+void BatchedDebugDraw::drawLine(const btVector3& from, const btVector3& to, const btVector3& color) {
+    if (vertices.size() >= maxLines * 2) {
+        ++droppedLines;
+        return;
+    }
+    uint32_t packed = packColor(color);
+    vertices.push_back(makeVertex(from, packed));
+    vertices.push_back(makeVertex(to, packed));
+}
+
+void BatchedDebugDraw::drawLine(const btVector3& from, const btVector3& to, const btVector3& fromColor,
+                                const btVector3& toColor) {
+    if (vertices.size() >= maxLines * 2) {
+        ++droppedLines;
+        return;
+    }
+    vertices.push_back(makeVertex(from, packColor(fromColor)));
+    vertices.push_back(makeVertex(to, packColor(toColor)));
+}
+
+void BatchedDebugDraw::drawContactPoint(const btVector3& pointOnB, const btVector3& normalOnB, btScalar distance,
+                                        int lifeTime, const btVector3& color) {
+    // Contacts become a short line along the normal so they share the line batch.
+    drawLine(pointOnB, pointOnB + normalOnB * kContactNormalLength, color);
+}
+
+void BatchedDebugDraw::reportErrorWarning(const char* warningString) {
+    std::cerr << "Bullet: " << warningString << std::endl;
+}
+
+void BatchedDebugDraw::draw3dText(const btVector3& location, const char* textString) {
+    // Text is not supported by the line batch.
+}
+
+void BatchedDebugDraw::clearLines() {
+    vertices.clear();
+    droppedLines = 0;
+}
@@ -0,0 +1,61 @@
+// debug_draw.h
+// Bullet debug drawer that batches every line into one CPU vertex array,
+// uploaded once and drawn with a single GL_LINES call per frame.
+
+#ifndef DEBUG_DRAW_H
+#define DEBUG_DRAW_H
+
+#include <glad/glad.h>
+
+#include <btBulletDynamicsCommon.h>
+
+#include <cstdint>
+#include <vector>
+
+struct DebugLineVertex {
+    float position[3];
+    uint32_t color; // RGBA8
+};
+
+class BatchedDebugDraw : public btIDebugDraw {
+public:
+    BatchedDebugDraw();
+
+    // GL resources; call with a current context.
+    void setup();
+    void destroy();
+
+    // Uploads the collected lines and draws them. The caller binds the debug
+    // line program and sets its uniforms.
+    void render();
+
+    // Lines beyond the cap are dropped (and counted) instead of growing the
+    // batch. Below the cap the batch grows as needed.
+    void setMaxLines(size_t maxLines);
+    size_t getMaxLines() const { return maxLines; }
+    size_t getLineCount() const { return vertices.size() / 2; }
+    size_t getDroppedLineCount() const { return droppedLines; }
+
+    // --- btIDebugDraw ---
+    void drawLine(const btVector3& from, const btVector3& to, const btVector3& color) override;
+    void drawLine(const btVector3& from, const btVector3& to, const btVector3& fromColor,
+                  const btVector3& toColor) override;
+    void drawContactPoint(const btVector3& pointOnB, const btVector3& normalOnB, btScalar distance,
+                          int lifeTime, const btVector3& color) override;
+    void reportErrorWarning(const char* warningString) override;
+    void draw3dText(const btVector3& location, const char* textString) override;
+    void setDebugMode(int mode) override { debugMode = mode; }
+    int getDebugMode() const override { return debugMode; }
+    void clearLines() override;
+
+private:
+    std::vector<DebugLineVertex> vertices;
+    size_t maxLines;
+    size_t droppedLines;
+    int debugMode;
+    GLuint VAO;
+    GLuint VBO;
+    GLsizeiptr vboCapacity; // in vertices
+};
+
+#endif // DEBUG_DRAW_H
@@ -0,0 +1,377 @@
+// engine_config.cpp
+// The settings table shared by config files and flags, value parsing, and
+// help and config output.
+
+#include "engine_config.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+struct ConfigOption {
+    std::string name;
+    std::string help;
+    bool isSwitch;                                      // a bool: "--name" and "--no-name" on the command line
+    std::function<bool(const std::string&)> parse;      // false on a bad value
+    std::function<std::string()> format;
+};
+
+std::string trim(const std::string& text) {
+    const size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos)
+        return std::string();
+    return text.substr(first, text.find_last_not_of(" \t\r\n") - first + 1);
+}
+
+bool parseInt(const std::string& text, long long& value) {
+    char* end = nullptr;
+    errno = 0;
+    value = std::strtoll(text.c_str(), &end, 10);
+    return !text.empty() && *end == '\0' && errno == 0;
+}
+
+bool parseFloat(const std::string& text, float& value) {
+    char* end = nullptr;
+    errno = 0;
+    value = std::strtof(text.c_str(), &end);
+    return !text.empty() && *end == '\0' && errno == 0;
+}
+
+bool parseBool(const std::string& text, bool& value) {
+    if (text == "true" || text == "on" || text == "yes" || text == "1")
+        value = true;
+    else if (text == "false" || text == "off" || text == "no" || text == "0")
+        value = false;
+    else
+        return false;
+    return true;
+}
+
+// The shortest of 6 or 9 significant digits that reads back to the same
+// float, so a written config reproduces the run exactly.
+std::string formatFloat(float value) {
+    std::ostringstream out;
+    out.precision(6);
+    out << value;
+    if (std::strtof(out.str().c_str(), nullptr) != value) {
+        out.str(std::string());
+        out.precision(9);
+        out << value;
+    }
+    return out.str();
+}
+
+ConfigOption intOption(const char* name, int& value, long long minimum, long long maximum, const char* help) {
+    ConfigOption option;
+    option.name = name;
+    option.help = help;
+    option.isSwitch = false;
+    int* target = &value;
+    option.parse = [=](const std::string& text) {
+        long long parsed = 0;
+        if (!parseInt(text, parsed) || parsed < minimum || parsed > maximum)
+            return false;
+        *target = static_cast<int>(parsed);
+        return true;
+    };
+    option.format = [=]() { return std::to_string(*target); };
+    return option;
+}
+
+ConfigOption unsignedOption(const char* name, uint32_t& value, const char* help) {
+    ConfigOption option;
+    option.name = name;
+    option.help = help;
+    option.isSwitch = false;
+    uint32_t* target = &value;
+    option.parse = [=](const std::string& text) {
+        long long parsed = 0;
+        if (!parseInt(text, parsed) || parsed < 0 || parsed > static_cast<long long>(UINT32_MAX))
+            return false;
+        *target = static_cast<uint32_t>(parsed);
+        return true;
+    };
+    option.format = [=]() { return std::to_string(*target); };
+    return option;
+}
+
+ConfigOption floatOption(const char* name, float& value, float minimum, float maximum, const char* help) {
+    ConfigOption option;
+    option.name = name;
+    option.help = help;
+    option.isSwitch = false;
+    float* target = &value;
+    option.parse = [=](const std::string& text) {
+        float parsed = 0.0f;
+        if (!parseFloat(text, parsed) || !(parsed >= minimum && parsed <= maximum))
+            return false;
+        *target = parsed;
+        return true;
+    };
+    option.format = [=]() { return formatFloat(*target); };
+    return option;
+}
+
+ConfigOption boolOption(const char* name, bool& value, const char* help) {
+    ConfigOption option;
+    option.name = name;
+    option.help = help;
+    option.isSwitch = true;
+    bool* target = &value;
+    option.parse = [=](const std::string& text) { return parseBool(text, *target); };
+    option.format = [=]() { return std::string(*target ? "true" : "false"); };
+    return option;
+}
+
+ConfigOption stringOption(const char* name, std::string& value, const char* help) {
+    ConfigOption option;
+    option.name = name;
+    option.help = help;
+    option.isSwitch = false;
+    std::string* target = &value;
+    option.parse = [=](const std::string& text) {
+        *target = text;
+        return true;
+    };
+    option.format = [=]() { return *target; };
+    return option;
+}
+
+// Three floats separated by spaces or commas.
+ConfigOption vectorOption(const char* name, glm::vec3& value, const char* help) {
+    ConfigOption option;
+    option.name = name;
+    option.help = help;
+    option.isSwitch = false;
+    glm::vec3* target = &value;
+    option.parse = [=](const std::string& text) {
+        std::string spaced = text;
+        for (char& c : spaced) {
+            if (c == ',')
+                c = ' ';
+        }
+        std::istringstream in(spaced);
+        std::string parts[3];
+        std::string extra;
+        if (!(in >> parts[0] >> parts[1] >> parts[2]) || (in >> extra))
+            return false;
+        glm::vec3 parsed;
+        for (int i = 0; i < 3; ++i) {
+            if (!parseFloat(parts[i], parsed[i]))
+                return false;
+        }
+        *target = parsed;
+        return true;
+    };
+    option.format = [=]() {
+        return formatFloat(target->x) + " " + formatFloat(target->y) + " " + formatFloat(target->z);
+    };
+    return option;
+}
+
+// The whole table, bound to config. Writing and help use the same one.
+std::vector<ConfigOption> configOptions(EngineConfig& config) {
+    std::vector<ConfigOption> options;
+    // Window and run
+    options.push_back(intOption("width", config.windowWidth, 1, 16384, "window or offscreen target width"));
+    options.push_back(intOption("height", config.windowHeight, 1, 16384, "window or offscreen target height"));
+    options.push_back(boolOption("headless", config.headless, "render offscreen through EGL, no window"));
+    options.push_back(intOption("frames", config.frames, 0, INT_MAX, "exit after this many frames (0: none, but 120 headless without seconds)"));
+    options.push_back(floatOption("seconds", config.seconds, 0.0f, 1e9f, "exit after this much wall-clock time (0: no limit)"));
+    options.push_back(stringOption("output", config.output, "headless: PPM file for the last frame"));
+    ConfigOption capture = stringOption("capture", config.captureFormat, "headless: record every frame, png or y4m");
+    std::string* captureFormat = &config.captureFormat;
+    capture.parse = [=](const std::string& text) {
+        if (text != "png" && text != "y4m" && !text.empty())
+            return false;
+        *captureFormat = text;
+        return true;
+    };
+    options.push_back(capture);
+    options.push_back(stringOption("capture-path", config.capturePath, "capture file or file prefix"));
+    options.push_back(intOption("steady-after", config.steadyAfter, -1, INT_MAX, "headless: fail on Bullet allocations from this frame on (-1: off)"));
+    options.push_back(intOption("threads", config.threads, 0, 1024, "threads, this one included (0: one per core)"));
+    // World
+    options.push_back(vectorOption("gravity", config.gravity, "x y z"));
+    options.push_back(floatOption("time-step", config.timeStep, 1e-4f, 1.0f, "simulated seconds per frame"));
+    options.push_back(intOption("substeps", config.substeps, 1, 64, "physics substeps per frame"));
+    options.push_back(intOption("solver-iterations", config.solverIterations, 1, 1000, "constraint solver iterations"));
+    options.push_back(intOption("manifold-pool", config.pools.manifoldPoolSize, 1, INT_MAX, "persistent manifolds preallocated"));
+    options.push_back(intOption("algorithm-pool", config.pools.collisionAlgorithmPoolSize, 1, INT_MAX, "collision algorithms preallocated"));
+    options.push_back(boolOption("pool-prewarm", config.pools.prewarm, "size the manifold lists for full pools up front"));
+    // Scene
+    options.push_back(intOption("boxes", config.scene.boxes, 0, 1000000, "boxes in the initial scene"));
+    options.push_back(intOption("spheres", config.scene.spheres, 0, 1000000, "spheres in the initial scene"));
+    ConfigOption pattern;
+    pattern.name = "pattern";
+    pattern.help = "initial placement: rows, grid, pile or random";
+    pattern.isSwitch = false;
+    ScenePattern* scenePattern = &config.scene.pattern;
+    pattern.parse = [=](const std::string& text) { return scenePatternFromName(text.c_str(), *scenePattern); };
+    pattern.format = [=]() { return std::string(scenePatternName(*scenePattern)); };
+    options.push_back(pattern);
+    options.push_back(floatOption("spacing", config.scene.spacing, 0.01f, 1000.0f, "distance between initial bodies"));
+    options.push_back(floatOption("spawn-height", config.scene.height, -1000.0f, 10000.0f, "height of the lowest initial bodies"));
+    options.push_back(floatOption("box-half-extent", config.scene.boxHalfExtent, 0.01f, 100.0f, "initial box size"));
+    options.push_back(floatOption("sphere-radius", config.scene.sphereRadius, 0.01f, 100.0f, "initial sphere size"));
+    options.push_back(unsignedOption("seed", config.scene.seed, "random pattern seed"));
+    // Rendering
+    options.push_back(boolOption("impostors", config.impostors, "draw spheres as ray-cast impostors"));
+    options.push_back(boolOption("indirect", config.indirect, "multi-draw indirect where GL 4.3 has it"));
+    options.push_back(boolOption("gpu-cull", config.gpuCull, "frustum cull on the GPU (indirect path)"));
+    options.push_back(boolOption("lighting", config.lighting, "directional light and ambient"));
+    options.push_back(boolOption("point-lights", config.pointLights, "clustered point lights"));
+    options.push_back(boolOption("shadows", config.shadows, "cascaded shadow maps"));
+    options.push_back(floatOption("shadow-distance", config.shadowDistance, 1.0f, 10000.0f, "shadow range"));
+    options.push_back(boolOption("idle", config.idle, "windowed: block while the scene is asleep"));
+    options.push_back(boolOption("governor", config.governor.enabled, "shed quality to hold the frame budget"));
+    options.push_back(floatOption("target-ms", config.governor.targetMilliseconds, 1.0f, 1000.0f, "frame budget"));
+    return options;
+}
+
+ConfigOption* findOption(std::vector<ConfigOption>& options, const std::string& name) {
+    for (ConfigOption& option : options) {
+        if (option.name == name)
+            return &option;
+    }
+    return nullptr;
+}
+
+bool applyOption(std::vector<ConfigOption>& options, const std::string& name, const std::string& value,
+                 const std::string& where) {
+    ConfigOption* option = findOption(options, name);
+    if (!option) {
+        std::cerr << where << ": unknown setting '" << name << "'" << std::endl;
+        return false;
+    }
+    if (!option->parse(value)) {
+        std::cerr << where << ": bad value '" << value << "' for " << name << " (" << option->help << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void printHelp(const char* program) {
+    EngineConfig defaults;
+    std::vector<ConfigOption> options = configOptions(defaults);
+    std::cout << "Usage: " << program << " [--config file] [--name value | --name=value | --switch | --no-switch]...\n"
+              << "  --config file         load settings from a file (\"name = value\" lines, # comments)\n"
+              << "  --print-config        print the settings in config file form and exit\n"
+              << "  --help                show this and exit\n";
+    for (const ConfigOption& option : options) {
+        std::string flag = "  --" + option.name;
+        if (!option.isSwitch)
+            flag += " v";
+        flag.resize(std::max<size_t>(flag.size() + 1, 24), ' ');
+        std::cout << flag << option.help << " [" << option.format() << "]\n";
+    }
+    std::cout.flush();
+}
+
+} // namespace
+
+bool loadEngineConfig(EngineConfig& config, const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Cannot open config file " << path << std::endl;
+        return false;
+    }
+    std::vector<ConfigOption> options = configOptions(config);
+    std::string line;
+    int lineNumber = 0;
+    bool ok = true;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        const std::string where = path + ":" + std::to_string(lineNumber);
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty())
+            continue;
+        const size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            std::cerr << where << ": expected name = value" << std::endl;
+            ok = false;
+            continue;
+        }
+        ok = applyOption(options, trim(line.substr(0, equals)), trim(line.substr(equals + 1)), where) && ok;
+    }
+    return ok;
+}
+
+ConfigResult parseEngineArguments(EngineConfig& config, int argc, char** argv) {
+    std::vector<ConfigOption> options = configOptions(config);
+    bool printConfig = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printHelp(argv[0]);
+            return ConfigResult::Exit;
+        }
+        if (arg == "--print-config") {
+            printConfig = true;
+            continue;
+        }
+        if (arg.compare(0, 2, "--") != 0) {
+            std::cerr << "Unexpected argument: " << arg << " (see --help)" << std::endl;
+            return ConfigResult::Error;
+        }
+        std::string name = arg.substr(2);
+        std::string value;
+        const size_t equals = name.find('=');
+        const bool inlineValue = equals != std::string::npos;
+        if (inlineValue) {
+            value = name.substr(equals + 1);
+            name = name.substr(0, equals);
+        }
+        if (name == "config") {
+            if (!inlineValue && i + 1 < argc)
+                value = argv[++i];
+            if (value.empty() || !loadEngineConfig(config, value))
+                return ConfigResult::Error;
+            continue;
+        }
+        ConfigOption* option = findOption(options, name);
+        if (!option && name.compare(0, 3, "no-") == 0) {
+            // "--no-name" clears a switch.
+            ConfigOption* negated = findOption(options, name.substr(3));
+            if (negated && negated->isSwitch && !inlineValue) {
+                negated->parse("false");
+                continue;
+            }
+        }
+        if (option && option->isSwitch && !inlineValue) {
+            option->parse("true");
+            continue;
+        }
+        if (option && !inlineValue) {
+            if (i + 1 >= argc) {
+                std::cerr << arg << ": missing value (" << option->help << ")" << std::endl;
+                return ConfigResult::Error;
+            }
+            value = argv[++i];
+        }
+        if (!applyOption(options, name, value, "Command line"))
+            return ConfigResult::Error;
+    }
+    if (printConfig) {
+        writeEngineConfig(std::cout, config);
+        return ConfigResult::Exit;
+    }
+    return ConfigResult::Run;
+}
+
+void writeEngineConfig(std::ostream& out, const EngineConfig& config) {
+    EngineConfig copy = config;
+    std::vector<ConfigOption> options = configOptions(copy);
+    for (const ConfigOption& option : options)
+        out << option.name << " = " << option.format() << "\n";
+    out.flush();
+}
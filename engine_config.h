@@ -0,0 +1,68 @@
+// engine_config.h
+// Engine settings for a run: window and run length, world parameters, the
+// initial scene, threads and renderer features. Settings come from defaults,
+// then config files and command line flags in the order they are given, so
+// later ones win. A config file has one "name = value" per line, with "#"
+// comments. Every name is also a flag: "--name value" or "--name=value", and
+// for switches "--name" or "--no-name".
+
+#ifndef ENGINE_CONFIG_H
+#define ENGINE_CONFIG_H
+
+#include <glm/glm.hpp>
+
+#include <ostream>
+#include <string>
+
+#include "frame_governor.h"
+#include "physics_pools.h"
+#include "scene_generator.h"
+
+struct EngineConfig {
+    // Window and run
+    int windowWidth = 1280;
+    int windowHeight = 720;
+    bool headless = false;              // render through EGL into an offscreen target
+    int frames = 0;                     // then exit; 0: none (headless: 120 unless seconds is set)
+    float seconds = 0.0f;               // wall-clock limit, then exit; 0: none
+    std::string output = "headless.ppm"; // headless: the last frame
+    std::string captureFormat;          // headless: "png" or "y4m" to record every frame
+    std::string capturePath;            // empty: the capture default
+    int steadyAfter = -1;               // headless: fail on Bullet allocations from this frame on
+    int threads = 0;                    // this thread included; 0: one per core
+    // World
+    glm::vec3 gravity = glm::vec3(0.0f, -9.81f, 0.0f);
+    float timeStep = 1.0f / 60.0f;      // simulated time per frame
+    int substeps = 1;
+    int solverIterations = 10;
+    PhysicsPoolSettings pools;
+    SceneSettings scene;
+    // Rendering
+    bool impostors = false;             // spheres as ray-cast impostors instead of mesh LODs
+    bool indirect = true;               // multi-draw indirect where GL 4.3 has it
+    bool gpuCull = true;
+    bool lighting = true;
+    bool pointLights = true;
+    bool shadows = true;
+    float shadowDistance = 100.0f;
+    bool idle = true;                   // windowed: block while the scene is asleep
+    FrameGovernorSettings governor;
+};
+
+// Loads a config file over config. Reports errors on std::cerr with the line.
+bool loadEngineConfig(EngineConfig& config, const std::string& path);
+
+enum class ConfigResult {
+    Run,
+    Exit,       // --help or --print-config was handled
+    Error
+};
+
+// Applies the command line in order; "--config path" loads a file at that
+// point. Unknown names and bad values are errors.
+ConfigResult parseEngineArguments(EngineConfig& config, int argc, char** argv);
+
+// Writes config in config file form, every setting included.
+void writeEngineConfig(std::ostream& out, const EngineConfig& config);
+
+#endif // ENGINE_CONFIG_H
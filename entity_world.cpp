@@ -0,0 +1,171 @@
+// entity_world.cpp
+// Archetype lookup, row add/remove and chunked iteration.
+
+#include "entity_world.h"
+
+#include <algorithm>
+
+namespace {
+
+uint32_t findOrAddArchetype(EntityWorld& world, ComponentMask components) {
+    for (size_t i = 0; i < world.archetypes.size(); ++i) {
+        if (world.archetypes[i].components == components)
+            return static_cast<uint32_t>(i);
+    }
+    Archetype archetype;
+    archetype.components = components;
+    world.archetypes.push_back(archetype);
+    return static_cast<uint32_t>(world.archetypes.size() - 1);
+}
+
+// Moves the last element of column into row and drops the last element.
+template <typename T>
+void swapRemove(std::vector<T>& column, uint32_t row) {
+    if (column.empty())
+        return;
+    column[row] = column.back();
+    column.pop_back();
+}
+
+} // namespace
+
+Entity createEntity(EntityWorld& world, ComponentMask components) {
+    uint32_t index;
+    if (!world.freeSlots.empty()) {
+        index = world.freeSlots.back();
+        world.freeSlots.pop_back();
+    } else {
+        index = static_cast<uint32_t>(world.slots.size());
+        world.slots.push_back(EntitySlot());
+    }
+    const uint32_t archetypeIndex = findOrAddArchetype(world, components);
+    Archetype& archetype = world.archetypes[archetypeIndex];
+    EntitySlot& slot = world.slots[index];
+    slot.archetype = archetypeIndex;
+    slot.row = static_cast<uint32_t>(archetype.entities.size());
+    slot.alive = true;
+
+    Entity entity;
+    entity.index = index;
+    entity.generation = slot.generation;
+    archetype.entities.push_back(entity);
+    if (components & kComponentTransform)
+        archetype.transforms.push_back(glm::mat4(1.0f));
+    if (components & kComponentBody)
+        archetype.bodies.push_back(nullptr);
+    if (components & kComponentRenderMesh)
+        archetype.meshes.push_back(RenderMesh());
+    if (components & kComponentColor)
+        archetype.colors.push_back(glm::vec3(1.0f));
+    if (components & kComponentLifetime)
+        archetype.lifetimes.push_back(0.0f);
+    if (components & kComponentLight)
+        archetype.lights.push_back(LightEmitter());
+    ++world.entityCount;
+    return entity;
+}
+
+void destroyEntity(EntityWorld& world, Entity entity) {
+    if (entity.index >= world.slots.size())
+        return;
+    EntitySlot& slot = world.slots[entity.index];
+    if (!slot.alive || slot.generation != entity.generation)
+        return;
+    Archetype& archetype = world.archetypes[slot.archetype];
+    const uint32_t row = slot.row;
+    const Entity moved = archetype.entities.back();
+    swapRemove(archetype.entities, row);
+    swapRemove(archetype.transforms, row);
+    swapRemove(archetype.bodies, row);
+    swapRemove(archetype.meshes, row);
+    swapRemove(archetype.colors, row);
+    swapRemove(archetype.lifetimes, row);
+    swapRemove(archetype.lights, row);
+    world.slots[moved.index].row = row;
+
+    slot.alive = false;
+    ++slot.generation;
+    world.freeSlots.push_back(entity.index);
+    --world.entityCount;
+}
+
+EntityRef lookupEntity(EntityWorld& world, Entity entity) {
+    EntityRef ref;
+    if (entity.index >= world.slots.size())
+        return ref;
+    const EntitySlot& slot = world.slots[entity.index];
+    if (!slot.alive || slot.generation != entity.generation)
+        return ref;
+    ref.archetype = &world.archetypes[slot.archetype];
+    ref.row = slot.row;
+    return ref;
+}
+
+void clearEntityWorld(EntityWorld& world) {
+    world.archetypes.clear();
+    world.freeSlots.clear();
+    // Slots are kept, one generation on, so old handles stay dead.
+    for (size_t i = world.slots.size(); i-- > 0;) {
+        EntitySlot& slot = world.slots[i];
+        if (slot.alive) {
+            slot.alive = false;
+            ++slot.generation;
+        }
+        world.freeSlots.push_back(static_cast<uint32_t>(i));
+    }
+    world.entityCount = 0;
+}
+
+size_t countEntities(const EntityWorld& world, ComponentMask required) {
+    size_t count = 0;
+    for (const Archetype& archetype : world.archetypes) {
+        if ((archetype.components & required) == required)
+            count += archetype.entities.size();
+    }
+    return count;
+}
+
+size_t collectEntityChunks(EntityWorld& world, ComponentMask required, std::vector<EntityChunk>& chunks) {
+    chunks.clear();
+    size_t rows = 0;
+    for (Archetype& archetype : world.archetypes) {
+        if ((archetype.components & required) != required)
+            continue;
+        const uint32_t size = static_cast<uint32_t>(archetype.entities.size());
+        for (uint32_t begin = 0; begin < size; begin += kEntityChunkRows) {
+            EntityChunk chunk;
+            chunk.entities = archetype.entities.data() + begin;
+            if (archetype.components & kComponentTransform)
+                chunk.transforms = archetype.transforms.data() + begin;
+            if (archetype.components & kComponentBody)
+                chunk.bodies = archetype.bodies.data() + begin;
+            if (archetype.components & kComponentRenderMesh)
+                chunk.meshes = archetype.meshes.data() + begin;
+            if (archetype.components & kComponentColor)
+                chunk.colors = archetype.colors.data() + begin;
+            if (archetype.components & kComponentLifetime)
+                chunk.lifetimes = archetype.lifetimes.data() + begin;
+            if (archetype.components & kComponentLight)
+                chunk.lights = archetype.lights.data() + begin;
+            chunk.count = std::min(kEntityChunkRows, size - begin);
+            chunk.first = rows;
+            rows += chunk.count;
+            chunks.push_back(chunk);
+        }
+    }
+    return rows;
+}
+
+void parallelForEntityChunks(JobSystem& jobs, const std::vector<EntityChunk>& chunks,
+                             const std::function<void(const EntityChunk&)>& system) {
+    const size_t rows = chunks.empty() ? 0 : chunks.back().first + chunks.back().count;
+    if (rows < kParallelEntityRows) {
+        for (const EntityChunk& chunk : chunks)
+            system(chunk);
+        return;
+    }
+    jobs.parallelFor(0, static_cast<int>(chunks.size()), 1, [&](int first, int last) {
+        for (int i = first; i < last; ++i)
+            system(chunks[i]);
+    });
+}
@@ -0,0 +1,125 @@
+// entity_world.h
+// Archetype entity-component storage. Entities with the same set of components
+// share an archetype, whose components are kept as dense parallel arrays
+// (structure of arrays), so a system streams through exactly the columns it
+// reads. Systems walk the rows in fixed-size chunks; chunks never overlap, so a
+// system that only writes its own chunk's rows can run chunks in parallel.
+
+#ifndef ENTITY_WORLD_H
+#define ENTITY_WORLD_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "job_system.h"
+
+class btRigidBody;
+
+typedef uint32_t ComponentMask;
+const ComponentMask kComponentTransform = 1u << 0;   // glm::mat4, rigid world transform
+const ComponentMask kComponentBody = 1u << 1;        // btRigidBody*, not owned
+const ComponentMask kComponentRenderMesh = 1u << 2;  // RenderMesh
+const ComponentMask kComponentColor = 1u << 3;       // glm::vec3
+const ComponentMask kComponentLifetime = 1u << 4;    // float, seconds left
+const ComponentMask kComponentLight = 1u << 5;       // LightEmitter
+
+// Rows per chunk handed to systems.
+const uint32_t kEntityChunkRows = 256;
+
+// Below this many rows, parallelForEntityChunks stays on the calling thread.
+const size_t kParallelEntityRows = 4096;
+
+struct RenderMesh {
+    uint32_t mesh = 0;                  // index into the caller's mesh table
+    glm::vec3 scale = glm::vec3(1.0f);  // applied before the transform
+    float boundingRadius = 0.0f;
+};
+
+struct LightEmitter {
+    glm::vec3 offset = glm::vec3(0.0f); // in the entity's frame
+    float radius = 0.0f;
+    glm::vec3 color = glm::vec3(0.0f);
+};
+
+// Index of a slot plus the slot's generation, so a handle to a destroyed
+// entity never resolves to whatever reuses the slot.
+struct Entity {
+    uint32_t index = 0;
+    uint32_t generation = 0;
+};
+
+struct Archetype {
+    ComponentMask components = 0;
+    std::vector<Entity> entities;   // row -> entity
+    // Columns; the ones not in components stay empty.
+    std::vector<glm::mat4> transforms;
+    std::vector<btRigidBody*> bodies;
+    std::vector<RenderMesh> meshes;
+    std::vector<glm::vec3> colors;
+    std::vector<float> lifetimes;
+    std::vector<LightEmitter> lights;
+};
+
+struct EntitySlot {
+    uint32_t archetype = 0;
+    uint32_t row = 0;
+    uint32_t generation = 0;
+    bool alive = false;
+};
+
+struct EntityWorld {
+    std::vector<Archetype> archetypes;
+    std::vector<EntitySlot> slots;
+    std::vector<uint32_t> freeSlots;
+    size_t entityCount = 0;
+};
+
+// Where a live entity's components are: archetype is null for a dead handle.
+// Valid until the next create or destroy.
+struct EntityRef {
+    Archetype* archetype = nullptr;
+    uint32_t row = 0;
+};
+
+// A run of rows of one archetype. Column pointers are null for components the
+// archetype does not have.
+struct EntityChunk {
+    const Entity* entities = nullptr;
+    glm::mat4* transforms = nullptr;
+    btRigidBody** bodies = nullptr;
+    RenderMesh* meshes = nullptr;
+    glm::vec3* colors = nullptr;
+    float* lifetimes = nullptr;
+    LightEmitter* lights = nullptr;
+    uint32_t count = 0;
+    size_t first = 0;   // rows in the chunks before this one, for flat per-row output
+};
+
+// Adds an entity with default-initialized components.
+Entity createEntity(EntityWorld& world, ComponentMask components);
+// Removes the entity's row (the archetype's last row moves into it). Ignores
+// dead handles.
+void destroyEntity(EntityWorld& world, Entity entity);
+EntityRef lookupEntity(EntityWorld& world, Entity entity);
+// Destroys every entity. Handles from before the clear stay dead.
+void clearEntityWorld(EntityWorld& world);
+
+// Entities that have all of the required components.
+size_t countEntities(const EntityWorld& world, ComponentMask required);
+
+// Fills chunks with every archetype that has all of the required components,
+// kEntityChunkRows rows at a time. Chunks stay valid until the next create or
+// destroy. Returns the total row count.
+size_t collectEntityChunks(EntityWorld& world, ComponentMask required, std::vector<EntityChunk>& chunks);
+
+// Runs system on every chunk, one job per chunk, when there are at least
+// kParallelEntityRows rows. system must only write its own chunk's rows (and
+// its own slice of any flat output), and must not create or destroy.
+void parallelForEntityChunks(JobSystem& jobs, const std::vector<EntityChunk>& chunks,
+                             const std::function<void(const EntityChunk&)>& system);
+
+#endif // ENTITY_WORLD_H
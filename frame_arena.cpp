@@ -0,0 +1,125 @@
+// frame_arena.cpp
+// Block bumping, the reset-time block merge and the per-thread registry.
+
+#include "frame_arena.h"
+
+#include <algorithm>
+#include <mutex>
+
+namespace {
+
+struct ThreadArenas {
+    FrameArena frame;
+    DoubleBufferedFrameArena twoFrame;
+};
+
+// Owns every thread's arenas, so they outlive the thread (workers are joined
+// while the registry lives on) and endFrameArenas can reach them all.
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadArenas>> registry;
+FrameArenaStats stats;
+uint64_t totalFrameBytes = 0;
+
+thread_local ThreadArenas* currentThreadArenas = nullptr;
+
+ThreadArenas& getThreadArenas() {
+    if (!currentThreadArenas) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry.push_back(std::unique_ptr<ThreadArenas>(new ThreadArenas));
+        currentThreadArenas = registry.back().get();
+    }
+    return *currentThreadArenas;
+}
+
+FrameArenaBlock makeBlock(size_t size) {
+    FrameArenaBlock block;
+    block.data.reset(new unsigned char[size]);
+    block.size = size;
+    return block;
+}
+
+size_t reservedBytes(const FrameArena& arena) {
+    size_t bytes = 0;
+    for (const FrameArenaBlock& block : arena.blocks)
+        bytes += block.size;
+    return bytes;
+}
+
+} // namespace
+
+void* frameArenaAllocate(FrameArena& arena, size_t size, size_t alignment) {
+    // new[] storage is aligned for any fundamental type, so aligning the offset
+    // aligns the address for everything but over-aligned types.
+    for (;;) {
+        if (arena.block < arena.blocks.size()) {
+            FrameArenaBlock& block = arena.blocks[arena.block];
+            const size_t start = (arena.offset + alignment - 1) / alignment * alignment;
+            if (start + size <= block.size) {
+                arena.used += start + size - arena.offset;
+                arena.offset = start + size;
+                return block.data.get() + start;
+            }
+            if (arena.block + 1 < arena.blocks.size()) {
+                ++arena.block;
+                arena.offset = 0;
+                continue;
+            }
+        }
+        arena.blocks.push_back(makeBlock(std::max(kFrameArenaBlockSize, size + alignment)));
+        arena.block = arena.blocks.size() - 1;
+        arena.offset = 0;
+    }
+}
+
+void resetFrameArena(FrameArena& arena) {
+    if (arena.blocks.size() > 1) {
+        const size_t size = reservedBytes(arena);
+        arena.blocks.clear();
+        arena.blocks.push_back(makeBlock(size));
+    }
+    arena.block = 0;
+    arena.offset = 0;
+    arena.used = 0;
+}
+
+FrameArena& currentFrameArenaBuffer(DoubleBufferedFrameArena& arena) {
+    return arena.buffers[arena.current];
+}
+
+void flipFrameArena(DoubleBufferedFrameArena& arena) {
+    arena.current ^= 1;
+    resetFrameArena(arena.buffers[arena.current]);
+}
+
+FrameArena& threadFrameArena() {
+    return getThreadArenas().frame;
+}
+
+FrameArena& threadTwoFrameArena() {
+    return currentFrameArenaBuffer(getThreadArenas().twoFrame);
+}
+
+void endFrameArenas() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    size_t frameBytes = 0;
+    size_t reserved = 0;
+    for (const std::unique_ptr<ThreadArenas>& arenas : registry) {
+        frameBytes += arenas->frame.used + currentFrameArenaBuffer(arenas->twoFrame).used;
+        resetFrameArena(arenas->frame);
+        flipFrameArena(arenas->twoFrame);
+        reserved += reservedBytes(arenas->frame) + reservedBytes(arenas->twoFrame.buffers[0]) +
+                    reservedBytes(arenas->twoFrame.buffers[1]);
+    }
+    ++stats.frames;
+    totalFrameBytes += frameBytes;
+    stats.lastFrameBytes = frameBytes;
+    stats.peakFrameBytes = std::max(stats.peakFrameBytes, frameBytes);
+    stats.averageFrameBytes = static_cast<double>(totalFrameBytes) / static_cast<double>(stats.frames);
+    stats.reservedBytes = reserved;
+    stats.threads = static_cast<int>(registry.size());
+}
+
+FrameArenaStats getFrameArenaStats() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    return stats;
+}
@@ -0,0 +1,110 @@
+// frame_arena.h
+// Linear (bump) allocators for data that only lives for a frame. Allocating is
+// a pointer bump inside a block and nothing is freed on its own; the whole
+// arena is reset at the end of the frame. Every thread gets its own arenas, so
+// jobs allocate without locking. The double-buffered arena keeps a frame's
+// allocations alive through the following frame too, for data that is read a
+// frame after it is written.
+
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Size of a thread's first block; frames that need more grow it at the reset.
+const size_t kFrameArenaBlockSize = 256 * 1024;
+
+struct FrameArenaBlock {
+    std::unique_ptr<unsigned char[]> data;
+    size_t size = 0;
+};
+
+struct FrameArena {
+    std::vector<FrameArenaBlock> blocks;
+    size_t block = 0;       // block being bumped
+    size_t offset = 0;      // in that block
+    size_t used = 0;        // bytes handed out since the reset, padding included
+};
+
+// Never returns null: a request the current block cannot take opens a new one.
+void* frameArenaAllocate(FrameArena& arena, size_t size, size_t alignment);
+// Forgets every allocation. A frame that spilled into extra blocks has them
+// merged into one block of their combined size, so later frames of that size
+// bump through a single block.
+void resetFrameArena(FrameArena& arena);
+
+struct DoubleBufferedFrameArena {
+    FrameArena buffers[2];
+    int current = 0;
+};
+
+FrameArena& currentFrameArenaBuffer(DoubleBufferedFrameArena& arena);
+// Makes the other buffer current and resets it. What was allocated before the
+// flip stays valid until the next one.
+void flipFrameArena(DoubleBufferedFrameArena& arena);
+
+// STL allocator over an arena. deallocate does nothing, so containers that
+// grow waste what they outgrow: reserve up front when the size is known.
+template <typename T>
+struct FrameAllocator {
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    FrameArena* arena = nullptr;
+
+    FrameAllocator() {}
+    explicit FrameAllocator(FrameArena& frameArena) : arena(&frameArena) {}
+    template <typename U>
+    FrameAllocator(const FrameAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(frameArenaAllocate(*arena, count * sizeof(T), alignof(T)));
+    }
+    void deallocate(T*, size_t) {}
+};
+
+template <typename T, typename U>
+bool operator==(const FrameAllocator<T>& a, const FrameAllocator<U>& b) {
+    return a.arena == b.arena;
+}
+
+template <typename T, typename U>
+bool operator!=(const FrameAllocator<T>& a, const FrameAllocator<U>& b) {
+    return a.arena != b.arena;
+}
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+// --- Per-thread arenas ---
+// Created on a thread's first call. Only frame work may use them: background
+// jobs (capture encoding) outlive the frame.
+
+// Reset by the next endFrameArenas.
+FrameArena& threadFrameArena();
+// Double-buffered: survives the next endFrameArenas, not the one after.
+FrameArena& threadTwoFrameArena();
+
+// Bytes used by all threads' arenas in a frame.
+struct FrameArenaStats {
+    size_t lastFrameBytes = 0;
+    size_t peakFrameBytes = 0;
+    double averageFrameBytes = 0.0;
+    size_t reservedBytes = 0;   // block memory held across threads
+    int threads = 0;            // threads that have arenas
+    uint64_t frames = 0;
+};
+
+// Ends the frame for every thread's arenas: records their usage, resets the
+// frame arenas and flips the double-buffered ones. Call once per frame from
+// the main thread, when no frame job is running.
+void endFrameArenas();
+FrameArenaStats getFrameArenaStats();
+
+#endif // FRAME_ARENA_H
@@ -0,0 +1,200 @@
+// frame_capture.cpp
+// PBO ring readback and the encoder job.
+
+#include "frame_capture.h"
+
+#include "image_writer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+FrameCapture::~FrameCapture() {
+    if (active)
+        std::cerr << "FrameCapture destroyed while active; call stop() with the context current" << std::endl;
+}
+
+bool FrameCapture::start(int frameWidth, int frameHeight, const FrameCaptureSettings& captureSettings,
+                         JobSystem& jobSystem) {
+    if (active)
+        stop();
+    settings = captureSettings;
+    if (settings.ringSize < 1)
+        settings.ringSize = 1;
+    width = frameWidth;
+    height = frameHeight;
+    frameBytes = static_cast<size_t>(width) * height * 4;
+    if (settings.format == CaptureFormat::Y4m) {
+        videoFile.open(settings.path.c_str(), std::ios::binary);
+        if (!videoFile) {
+            std::cerr << "Failed to open " << settings.path << " for writing" << std::endl;
+            return false;
+        }
+        writeY4mHeader(videoFile, width, height, settings.framesPerSecond);
+    }
+    slots.assign(settings.ringSize, Slot());
+    for (Slot& slot : slots) {
+        glGenBuffers(1, &slot.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    nextSlot = 0;
+    nextFrameIndex = 0;
+    stats = FrameCaptureStats();
+    totalEncodeMilliseconds = 0.0;
+    jobs = &jobSystem;
+    active = true;
+    return true;
+}
+
+void FrameCapture::stop() {
+    if (!active)
+        return;
+    // Oldest first, so frames reach the encoder in order.
+    for (size_t i = 0; i < slots.size(); ++i)
+        collectSlot(slots[(nextSlot + i) % slots.size()]);
+    for (Slot& slot : slots)
+        glDeleteBuffers(1, &slot.buffer);
+    slots.clear();
+    jobs->wait(encoder);
+    if (videoFile.is_open())
+        videoFile.close();
+    freeBuffers.clear();
+    active = false;
+    std::cout << "Capture stopped: " << stats.framesWritten << " frames written, " << stats.framesDropped
+              << " dropped, " << stats.readbackStalls << " readback stalls" << std::endl;
+}
+
+void FrameCapture::captureFrame(GLuint framebuffer) {
+    if (!active)
+        return;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    // Finished readbacks are handed over, oldest first, as soon as their fence
+    // has signalled; stop at the first one still pending to keep frames in order.
+    for (size_t i = 0; i < slots.size(); ++i) {
+        Slot& pending = slots[(nextSlot + i) % slots.size()];
+        if (!pending.fence)
+            continue;
+        if (glClientWaitSync(pending.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+            break;
+        collectSlot(pending);
+    }
+    Slot& slot = slots[nextSlot];
+    if (slot.fence) {
+        // The GPU is a whole ring behind; waiting here is the only stall.
+        ++stats.readbackStalls;
+        collectSlot(slot);
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frameIndex = nextFrameIndex++;
+    nextSlot = (nextSlot + 1) % slots.size();
+    ++stats.framesCaptured;
+    stats.lastCaptureMilliseconds =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+FrameCaptureStats FrameCapture::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.framesQueued = queue.size();
+    return stats;
+}
+
+void FrameCapture::collectSlot(Slot& slot) {
+    if (!slot.fence)
+        return;
+    glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    EncodedFrame frame;
+    frame.frameIndex = slot.frameIndex;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (queue.size() >= settings.maxQueuedFrames) {
+            if (settings.dropWhenBehind) {
+                ++stats.framesDropped;
+                return;
+            }
+            // The encoder job drains the whole queue before it finishes.
+            lock.unlock();
+            jobs->wait(encoder);
+            lock.lock();
+        }
+        if (!freeBuffers.empty()) {
+            frame.pixels.swap(freeBuffers.back());
+            freeBuffers.pop_back();
+        }
+    }
+    frame.pixels.resize(frameBytes);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameBytes, GL_MAP_READ_BIT);
+    if (mapped) {
+        std::memcpy(frame.pixels.data(), mapped, frameBytes);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (!mapped)
+        return;
+    bool startEncoder = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(frame));
+        startEncoder = !encoding;
+        encoding = true;
+    }
+    // Outside the lock: without workers the encoder runs inline, right here.
+    if (startEncoder)
+        jobs->runBackground([this]() { encodeQueued(); }, &encoder);
+}
+
+void FrameCapture::encodeQueued() {
+    for (;;) {
+        EncodedFrame frame;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (queue.empty()) {
+                encoding = false;
+                return;
+            }
+            frame = std::move(queue.front());
+            queue.pop_front();
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        encode(frame, rgbScratch);
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::lock_guard<std::mutex> lock(mutex);
+        ++stats.framesWritten;
+        totalEncodeMilliseconds += milliseconds;
+        stats.averageEncodeMilliseconds = totalEncodeMilliseconds / static_cast<double>(stats.framesWritten);
+        freeBuffers.push_back(std::vector<unsigned char>());
+        freeBuffers.back().swap(frame.pixels);
+    }
+}
+
+void FrameCapture::encode(EncodedFrame& frame, std::vector<unsigned char>& rgb) {
+    // RGBA bottom-up -> RGB top-down.
+    rgb.resize(static_cast<size_t>(width) * height * 3);
+    for (int y = 0; y < height; ++y) {
+        const unsigned char* src = &frame.pixels[static_cast<size_t>(height - 1 - y) * width * 4];
+        unsigned char* dst = &rgb[static_cast<size_t>(y) * width * 3];
+        for (int x = 0; x < width; ++x) {
+            dst[x * 3 + 0] = src[x * 4 + 0];
+            dst[x * 3 + 1] = src[x * 4 + 1];
+            dst[x * 3 + 2] = src[x * 4 + 2];
+        }
+    }
+    if (settings.format == CaptureFormat::Y4m) {
+        writeY4mFrame(videoFile, width, height, rgb);
+    } else {
+        char number[32];
+        std::snprintf(number, sizeof(number), "%05llu", static_cast<unsigned long long>(frame.frameIndex));
+        writePng(settings.path + number + ".png", width, height, rgb);
+    }
+}
@@ -0,0 +1,104 @@
+// frame_capture.h
+// Frame capture without stalling the render loop: each captured frame is read
+// into the next pixel buffer object of a small ring and fenced; a few frames
+// later, once its fence has signalled, the buffer is mapped and the pixels are
+// handed to an encoder job, run in the background of the shared job system.
+
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "job_system.h"
+
+enum class CaptureFormat {
+    Png,    // one file per frame: <path>00000.png, <path>00001.png, ...
+    Y4m     // one YUV4MPEG2 stream at <path>
+};
+
+struct FrameCaptureSettings {
+    CaptureFormat format = CaptureFormat::Png;
+    std::string path = "capture_";
+    int framesPerSecond = 60;      // Y4M header only
+    size_t ringSize = 3;           // PBOs in flight; frames of latency before mapping
+    size_t maxQueuedFrames = 8;    // frames waiting for the encoder
+    bool dropWhenBehind = true;    // drop frames when the encoder falls behind instead of waiting
+};
+
+struct FrameCaptureStats {
+    uint64_t framesCaptured = 0;   // readbacks issued
+    uint64_t framesWritten = 0;    // encoded to disk
+    uint64_t framesDropped = 0;    // encoder queue was full
+    uint64_t readbackStalls = 0;   // ring slot reused before its fence signalled
+    size_t framesQueued = 0;
+    double lastCaptureMilliseconds = 0.0; // render-thread cost of the last captureFrame
+    double averageEncodeMilliseconds = 0.0;
+};
+
+class FrameCapture {
+public:
+    FrameCapture() = default;
+    ~FrameCapture();
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // Allocates the PBO ring for width x height frames; frames are encoded on
+    // jobs, which must outlive the capture.
+    bool start(int width, int height, const FrameCaptureSettings& settings, JobSystem& jobs);
+    // Flushes every frame still in flight, waits for the encoder and releases
+    // the PBOs. Needs the GL context that called start.
+    void stop();
+    bool isActive() const { return active; }
+
+    // Queues a readback of the framebuffer's current read buffer (call after
+    // the frame is drawn, before swapping) and hands any completed readbacks to
+    // the encoder.
+    void captureFrame(GLuint framebuffer);
+
+    FrameCaptureStats getStats();
+
+private:
+    struct Slot {
+        GLuint buffer = 0;
+        GLsync fence = nullptr;
+        uint64_t frameIndex = 0;
+    };
+    struct EncodedFrame {
+        std::vector<unsigned char> pixels; // RGBA rows, bottom row first
+        uint64_t frameIndex = 0;
+    };
+
+    void collectSlot(Slot& slot);
+    void encodeQueued();
+    void encode(EncodedFrame& frame, std::vector<unsigned char>& rgb);
+
+    bool active = false;
+    FrameCaptureSettings settings;
+    int width = 0;
+    int height = 0;
+    size_t frameBytes = 0;
+    std::vector<Slot> slots;
+    size_t nextSlot = 0;
+    uint64_t nextFrameIndex = 0;
+    FrameCaptureStats stats;
+
+    // One encoder job at a time drains the queue, which keeps frames in order.
+    JobSystem* jobs = nullptr;
+    JobCounter encoder;
+    std::mutex mutex;
+    std::deque<EncodedFrame> queue;
+    std::vector<std::vector<unsigned char>> freeBuffers; // recycled pixel storage
+    bool encoding = false;                               // an encoder job is queued or running
+    std::vector<unsigned char> rgbScratch;               // encoder scratch
+    std::ofstream videoFile;
+    double totalEncodeMilliseconds = 0.0;
+};
+
+#endif // FRAME_CAPTURE_H
@@ -0,0 +1,132 @@
+// frame_governor.cpp
+// Shedding and restoring quality steps against the frame budget.
+
+#include "frame_governor.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+// The longest restore wait, in multiples of restoreFrames.
+const int kMaxRestoreBackoff = 8;
+
+const GovernorStep kPhysicsSteps[] = {GovernorStep::PhysicsSubsteps, GovernorStep::SolverIterations};
+const GovernorStep kRenderSteps[] = {GovernorStep::SphereLod, GovernorStep::DebugDraw, GovernorStep::Shadows};
+
+template <size_t N>
+bool firstCandidate(const GovernorStep (&steps)[N], uint32_t candidates, GovernorStep& step) {
+    for (GovernorStep candidate : steps) {
+        if (candidates & governorStepBit(candidate)) {
+            step = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Sheds from the side that costs more: physics when the CPU is the bottleneck
+// and physics is the larger part of it, rendering otherwise. Falls back to
+// the other side once the first has nothing left.
+bool pickStep(const FrameCosts& costs, uint32_t candidates, GovernorStep& step) {
+    const double cpu = costs.physics + costs.render + costs.ui;
+    const bool physicsFirst = cpu >= costs.gpu && costs.physics >= costs.render;
+    if (physicsFirst)
+        return firstCandidate(kPhysicsSteps, candidates, step) || firstCandidate(kRenderSteps, candidates, step);
+    return firstCandidate(kRenderSteps, candidates, step) || firstCandidate(kPhysicsSteps, candidates, step);
+}
+
+void logDecision(FrameGovernor& governor, const char* text) {
+    GovernorDecision decision;
+    decision.frame = governor.frame;
+    decision.text = text;
+    governor.log.push_back(decision);
+    if (governor.log.size() > kGovernorLogSize)
+        governor.log.pop_front();
+    ++governor.decisions;
+}
+
+} // namespace
+
+double frameCost(const FrameCosts& costs) {
+    return std::max(costs.physics + costs.render + costs.ui, costs.gpu);
+}
+
+bool updateFrameGovernor(FrameGovernor& governor, const FrameCosts& costs, uint32_t available) {
+    const FrameGovernorSettings& settings = governor.settings;
+    ++governor.frame;
+    governor.cost = frameCost(costs);
+    // A restore that held for a full restore period halves the backoff again.
+    if (governor.restoreBackoff > 1 && governor.lastRestoreFrame > governor.lastShedFrame &&
+        governor.frame - governor.lastRestoreFrame == static_cast<uint64_t>(settings.restoreFrames))
+        governor.restoreBackoff /= 2;
+
+    // Between the restore threshold and the target both counters start over.
+    if (governor.cost > settings.targetMilliseconds) {
+        ++governor.overFrames;
+        governor.underFrames = 0;
+    } else if (governor.cost <= settings.targetMilliseconds * settings.restoreRatio) {
+        ++governor.underFrames;
+        governor.overFrames = 0;
+    } else {
+        governor.overFrames = 0;
+        governor.underFrames = 0;
+    }
+
+    char text[192];
+    if (governor.overFrames >= settings.shedFrames) {
+        governor.overFrames = 0;
+        GovernorStep step;
+        if (!pickStep(costs, available & ~governor.shed, step))
+            return false;
+        // Shed again soon after a restore: wait longer before the next one.
+        if (governor.lastRestoreFrame > governor.lastShedFrame &&
+            governor.frame - governor.lastRestoreFrame < static_cast<uint64_t>(settings.restoreFrames))
+            governor.restoreBackoff = std::min(governor.restoreBackoff * 2, kMaxRestoreBackoff);
+        governor.shed |= governorStepBit(step);
+        governor.order.push_back(step);
+        governor.lastShedFrame = governor.frame;
+        std::snprintf(text, sizeof(text),
+                      "%.1f > %.1f ms (physics %.1f, render %.1f, UI %.1f, GPU %.1f): shed %s",
+                      governor.cost, settings.targetMilliseconds, costs.physics, costs.render, costs.ui, costs.gpu,
+                      governorStepName(step));
+        logDecision(governor, text);
+        return true;
+    }
+    if (!governor.order.empty() && governor.underFrames >= settings.restoreFrames * governor.restoreBackoff) {
+        const GovernorStep step = governor.order.back();
+        governor.order.pop_back();
+        governor.shed &= ~governorStepBit(step);
+        governor.lastRestoreFrame = governor.frame;
+        std::snprintf(text, sizeof(text), "%.1f <= %.1f ms for %d frames: restored %s",
+                      governor.cost, settings.targetMilliseconds * settings.restoreRatio, governor.underFrames,
+                      governorStepName(step));
+        governor.underFrames = 0;
+        logDecision(governor, text);
+        return true;
+    }
+    return false;
+}
+
+bool governorShed(const FrameGovernor& governor, GovernorStep step) {
+    return (governor.shed & governorStepBit(step)) != 0;
+}
+
+void resetFrameGovernor(FrameGovernor& governor, const char* reason) {
+    if (!governor.order.empty()) {
+        char text[192];
+        std::snprintf(text, sizeof(text), "%s: restored all %zu shed steps", reason, governor.order.size());
+        logDecision(governor, text);
+    }
+    governor.shed = 0;
+    governor.order.clear();
+    governor.overFrames = 0;
+    governor.underFrames = 0;
+    governor.restoreBackoff = 1;
+}
+
+const char* governorStepName(GovernorStep step) {
+    static const char* const names[kGovernorStepCount] = {"physics substeps", "solver iterations", "sphere LOD",
+                                                          "physics debug draw", "shadows"};
+    return names[static_cast<uint32_t>(step)];
+}
@@ -0,0 +1,87 @@
+// frame_governor.h
+// Frame time budget governor. Each frame's physics, render, UI and GPU costs
+// are held against a target frame time. While the frame runs over the target,
+// quality steps are shed one at a time from whichever side costs more:
+// physics (substeps, then solver iterations) or rendering (sphere LOD, then
+// debug draw, then shadows). Once the frame is well under the target again
+// they are restored, newest first. Shedding needs a short run of slow frames
+// and restoring a much longer run of fast ones. A step that is shed again
+// soon after being restored doubles the wait before the next restore, so the
+// governor does not oscillate around the target. Every decision is logged.
+
+#ifndef FRAME_GOVERNOR_H
+#define FRAME_GOVERNOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+enum class GovernorStep : uint32_t {
+    PhysicsSubsteps,    // one physics substep per frame
+    SolverIterations,   // half the solver iterations
+    SphereLod,          // coarser sphere LODs
+    DebugDraw,          // physics debug lines off
+    Shadows             // cascaded shadows off
+};
+
+const int kGovernorStepCount = 5;
+const size_t kGovernorLogSize = 64;
+
+inline uint32_t governorStepBit(GovernorStep step) {
+    return 1u << static_cast<uint32_t>(step);
+}
+
+// Milliseconds spent on the frame, by where the time went.
+struct FrameCosts {
+    double physics = 0.0;   // CPU
+    double render = 0.0;    // CPU, scene preparation and submission
+    double ui = 0.0;        // CPU
+    double gpu = 0.0;       // every GPU-timed pass
+};
+
+struct FrameGovernorSettings {
+    bool enabled = true;
+    float targetMilliseconds = 16.6f;
+    float restoreRatio = 0.7f;  // restore only once the frame takes at most this share of the target
+    int shedFrames = 30;        // consecutive frames over the target before shedding a step
+    int restoreFrames = 180;    // consecutive frames under the restore ratio before restoring one
+};
+
+struct GovernorDecision {
+    uint64_t frame = 0;
+    std::string text;
+};
+
+struct FrameGovernor {
+    FrameGovernorSettings settings;
+    uint32_t shed = 0;                  // governorStepBit of every step in effect
+    std::vector<GovernorStep> order;    // shed steps, oldest first
+    int overFrames = 0;
+    int underFrames = 0;
+    int restoreBackoff = 1;             // multiplies restoreFrames
+    uint64_t frame = 0;
+    uint64_t lastShedFrame = 0;
+    uint64_t lastRestoreFrame = 0;
+    double cost = 0.0;                  // last frame's, the larger of CPU and GPU
+    std::deque<GovernorDecision> log;   // newest last, at most kGovernorLogSize
+    uint64_t decisions = 0;
+};
+
+// The frame cost the target applies to: CPU and GPU run in parallel, so the
+// slower of the two.
+double frameCost(const FrameCosts& costs);
+
+// Feeds one frame. available has the bits of the steps that would change
+// anything if shed now. Returns true when a step was shed or restored.
+bool updateFrameGovernor(FrameGovernor& governor, const FrameCosts& costs, uint32_t available);
+
+bool governorShed(const FrameGovernor& governor, GovernorStep step);
+
+// Restores every step at once and logs why.
+void resetFrameGovernor(FrameGovernor& governor, const char* reason);
+
+const char* governorStepName(GovernorStep step);
+
+#endif // FRAME_GOVERNOR_H
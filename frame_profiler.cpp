@@ -0,0 +1,87 @@
+// frame_profiler.cpp
+// CPU phase timing and the GL_TIME_ELAPSED query ring.
+
+#include "frame_profiler.h"
+
+namespace {
+
+// Exponential smoothing weight of the newest sample.
+const double kProfilerSmoothing = 0.1;
+
+double smooth(double average, double sample) {
+    return average == 0.0 ? sample : average + (sample - average) * kProfilerSmoothing;
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int addProfilerPhase(FrameProfiler& profiler, const std::string& name, bool gpuTimed) {
+    ProfilerPhase phase;
+    phase.name = name;
+    phase.gpuTimed = gpuTimed;
+    if (gpuTimed)
+        glGenQueries(kProfilerLatency, phase.queries);
+    profiler.phases.push_back(phase);
+    return static_cast<int>(profiler.phases.size() - 1);
+}
+
+void destroyFrameProfiler(FrameProfiler& profiler) {
+    for (ProfilerPhase& phase : profiler.phases) {
+        if (phase.gpuTimed)
+            glDeleteQueries(kProfilerLatency, phase.queries);
+    }
+    profiler = FrameProfiler();
+}
+
+void beginProfilerFrame(FrameProfiler& profiler) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (profiler.frame > 0)
+        profiler.frameMilliseconds = smooth(profiler.frameMilliseconds,
+                                            std::chrono::duration<double, std::milli>(now - profiler.frameStart).count());
+    profiler.frameStart = now;
+    ++profiler.frame;
+    const int slot = static_cast<int>(profiler.frame % kProfilerLatency);
+    for (ProfilerPhase& phase : profiler.phases) {
+        if (!phase.pending[slot])
+            continue;
+        phase.pending[slot] = false;
+        GLint available = 0;
+        glGetQueryObjectiv(phase.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            // Never wait: the slot is reissued this frame and the sample is lost.
+            ++profiler.lateGpuResults;
+            continue;
+        }
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(phase.queries[slot], GL_QUERY_RESULT, &nanoseconds);
+        phase.gpuMilliseconds = smooth(phase.gpuMilliseconds, static_cast<double>(nanoseconds) * 1e-6);
+    }
+}
+
+void beginProfilerPhase(FrameProfiler& profiler, int phase) {
+    ProfilerPhase& p = profiler.phases[phase];
+    p.lastFrame = profiler.frame;
+    p.cpuStart = std::chrono::steady_clock::now();
+    if (p.gpuTimed)
+        glBeginQuery(GL_TIME_ELAPSED, p.queries[profiler.frame % kProfilerLatency]);
+}
+
+void endProfilerPhase(FrameProfiler& profiler, int phase) {
+    ProfilerPhase& p = profiler.phases[phase];
+    if (p.gpuTimed) {
+        glEndQuery(GL_TIME_ELAPSED);
+        p.pending[profiler.frame % kProfilerLatency] = true;
+    }
+    p.cpuMilliseconds = smooth(p.cpuMilliseconds, millisecondsSince(p.cpuStart));
+}
+
+void endProfilerWork(FrameProfiler& profiler) {
+    profiler.workMilliseconds = smooth(profiler.workMilliseconds, millisecondsSince(profiler.frameStart));
+}
+
+bool profilerPhaseActive(const FrameProfiler& profiler, int phase) {
+    return profiler.phases[phase].lastFrame == profiler.frame;
+}
@@ -0,0 +1,57 @@
+// frame_profiler.h
+// Per-phase CPU and GPU frame timings. GPU time comes from GL_TIME_ELAPSED
+// queries kept in a ring kProfilerLatency frames deep: a query's result is
+// only read when its slot comes round again, by which time the GPU has long
+// finished it, so reading never stalls the pipeline.
+
+#ifndef FRAME_PROFILER_H
+#define FRAME_PROFILER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+const int kProfilerLatency = 4;
+
+struct ProfilerPhase {
+    std::string name;
+    bool gpuTimed = true;                   // false for CPU-only phases (physics)
+    double cpuMilliseconds = 0.0;           // smoothed
+    double gpuMilliseconds = 0.0;           // smoothed, kProfilerLatency frames old
+    uint64_t lastFrame = 0;                 // last frame the phase ran in
+    std::chrono::steady_clock::time_point cpuStart;
+    GLuint queries[kProfilerLatency] = {};
+    bool pending[kProfilerLatency] = {};
+};
+
+struct FrameProfiler {
+    std::vector<ProfilerPhase> phases;
+    uint64_t frame = 0;
+    uint64_t lateGpuResults = 0;            // results still unavailable after the latency window (dropped)
+    double frameMilliseconds = 0.0;         // smoothed time between beginProfilerFrame calls
+    double workMilliseconds = 0.0;          // smoothed time from beginProfilerFrame to endProfilerWork
+    std::chrono::steady_clock::time_point frameStart;
+};
+
+// Registers a phase and returns its index. Needs a current context when gpuTimed.
+int addProfilerPhase(FrameProfiler& profiler, const std::string& name, bool gpuTimed);
+void destroyFrameProfiler(FrameProfiler& profiler);
+
+// Starts a frame: collects the GPU results of the ring slot about to be reused.
+void beginProfilerFrame(FrameProfiler& profiler);
+
+// Phases must not nest (GL allows one active GL_TIME_ELAPSED query).
+void beginProfilerPhase(FrameProfiler& profiler, int phase);
+void endProfilerPhase(FrameProfiler& profiler, int phase);
+
+// Ends the frame's CPU work, before the buffer swap, so the wait for the
+// swap interval is left out of workMilliseconds.
+void endProfilerWork(FrameProfiler& profiler);
+
+// True when the phase ran during the current frame.
+bool profilerPhaseActive(const FrameProfiler& profiler, int phase);
+
+#endif // FRAME_PROFILER_H
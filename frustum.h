@@ -0,0 +1,21 @@
+// frustum.h
+// View frustum planes and bounding-sphere tests.
+
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+// Six normalized planes (left, right, bottom, top, near, far) with inward
+// normals: a point p is inside a plane when dot(plane.xyz, p) + plane.w >= 0.
+struct Frustum {
+    glm::vec4 planes[6];
+};
+
+// Extracts the planes of a combined projection * view matrix (Gribb-Hartmann).
+Frustum extractFrustum(const glm::mat4& viewProj);
+
+// True if the sphere touches or lies inside the frustum.
+bool sphereInFrustum(const Frustum& frustum, const glm::vec3& center, float radius);
+
+#endif // FRUSTUM_H
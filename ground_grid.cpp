@@ -0,0 +1,22 @@
+// ground_grid.cpp
+// Full-screen triangle submission for the ground grid.
+
+#include "ground_grid.h"
+
+GroundGridRenderer createGroundGridRenderer() {
+    GroundGridRenderer renderer;
+    // Core profile needs a bound VAO even when a draw reads no attributes.
+    glGenVertexArrays(1, &renderer.VAO);
+    return renderer;
+}
+
+void destroyGroundGridRenderer(GroundGridRenderer& renderer) {
+    glDeleteVertexArrays(1, &renderer.VAO);
+    renderer = GroundGridRenderer();
+}
+
+void drawGroundGrid(const GroundGridRenderer& renderer) {
+    glBindVertexArray(renderer.VAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+}
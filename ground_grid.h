@@ -0,0 +1,22 @@
+// ground_grid.h
+// Infinite ground plane: one full-screen triangle whose fragments are
+// ray-cast against y = 0, shaded with an anti-aliased grid that fades out with
+// distance, and written at the hit point's depth.
+
+#ifndef GROUND_GRID_H
+#define GROUND_GRID_H
+
+#include <glad/glad.h>
+
+struct GroundGridRenderer {
+    GLuint VAO = 0;   // no attributes; corners come from gl_VertexID
+};
+
+GroundGridRenderer createGroundGridRenderer();
+void destroyGroundGridRenderer(GroundGridRenderer& renderer);
+
+// Draws the full-screen triangle. The caller binds the ground program and sets
+// its uniforms.
+void drawGroundGrid(const GroundGridRenderer& renderer);
+
+#endif // GROUND_GRID_H
@@ -0,0 +1,143 @@
+// headless_context.cpp
+// EGL display, config and context setup for headless rendering.
+
+#include "headless_context.h"
+
+#include <iostream>
+
+#ifdef ENGINE_HAS_EGL
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstring>
+
+namespace {
+
+bool hasExtension(const char* extensions, const char* name) {
+    if (!extensions)
+        return false;
+    const size_t length = std::strlen(name);
+    for (const char* p = std::strstr(extensions, name); p; p = std::strstr(p + length, name)) {
+        if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0'))
+            return true;
+    }
+    return false;
+}
+
+EGLDisplay openDisplay() {
+    // The surfaceless platform needs neither X11 nor a DRM device.
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay) {
+            EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display != EGL_NO_DISPLAY)
+                return display;
+        }
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+} // namespace
+
+bool createHeadlessContext(HeadlessContext& headless) {
+    EGLDisplay display = openDisplay();
+    EGLint major = 0, minor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        std::cerr << "EGL: no display available" << std::endl;
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "EGL: desktop OpenGL is not supported" << std::endl;
+        eglTerminate(display);
+        return false;
+    }
+    const bool surfaceless = hasExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+        std::cerr << "EGL: no OpenGL-capable config" << std::endl;
+        eglTerminate(display);
+        return false;
+    }
+    // Same version preference as the windowed path: 4.3 for indirect draws, 3.3 otherwise.
+    const int contextVersions[][2] = { { 4, 3 }, { 3, 3 } };
+    EGLContext context = EGL_NO_CONTEXT;
+    for (const auto& version : contextVersions) {
+        const EGLint contextAttributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, version[0],
+            EGL_CONTEXT_MINOR_VERSION, version[1],
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+        if (context != EGL_NO_CONTEXT) {
+            headless.glMajor = version[0];
+            headless.glMinor = version[1];
+            break;
+        }
+    }
+    if (context == EGL_NO_CONTEXT) {
+        std::cerr << "EGL: failed to create a core profile context" << std::endl;
+        eglTerminate(display);
+        return false;
+    }
+    EGLSurface surface = EGL_NO_SURFACE;
+    if (!surfaceless) {
+        const EGLint pbufferAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        surface = eglCreatePbufferSurface(display, config, pbufferAttributes);
+    }
+    if (!eglMakeCurrent(display, surface, surface, context)) {
+        std::cerr << "EGL: failed to make the context current" << std::endl;
+        if (surface != EGL_NO_SURFACE)
+            eglDestroySurface(display, surface);
+        eglDestroyContext(display, context);
+        eglTerminate(display);
+        return false;
+    }
+    headless.display = display;
+    headless.context = context;
+    headless.surface = surface;
+    std::cout << "EGL " << major << "." << minor << ": GL " << headless.glMajor << "." << headless.glMinor
+              << " core context, " << (surfaceless ? "surfaceless" : "pbuffer") << std::endl;
+    return true;
+}
+
+void destroyHeadlessContext(HeadlessContext& headless) {
+    if (!headless.display)
+        return;
+    EGLDisplay display = static_cast<EGLDisplay>(headless.display);
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (headless.surface)
+        eglDestroySurface(display, static_cast<EGLSurface>(headless.surface));
+    eglDestroyContext(display, static_cast<EGLContext>(headless.context));
+    eglTerminate(display);
+    headless = HeadlessContext();
+}
+
+void* headlessGetProcAddress(const char* name) {
+    return reinterpret_cast<void*>(eglGetProcAddress(name));
+}
+
+#else // ENGINE_HAS_EGL
+
+bool createHeadlessContext(HeadlessContext&) {
+    std::cerr << "Headless rendering is unavailable: built without EGL" << std::endl;
+    return false;
+}
+
+void destroyHeadlessContext(HeadlessContext&) {}
+
+void* headlessGetProcAddress(const char*) {
+    return nullptr;
+}
+
+#endif // ENGINE_HAS_EGL
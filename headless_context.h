@@ -0,0 +1,27 @@
+// headless_context.h
+// Window-less OpenGL context through EGL, for rendering on machines with no
+// display server (Mesa llvmpipe included). Available when the build found EGL
+// (ENGINE_HAS_EGL); otherwise creation fails with a message.
+
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+// EGL handles are kept opaque so callers do not pull in the EGL headers.
+struct HeadlessContext {
+    void* display = nullptr;
+    void* context = nullptr;
+    void* surface = nullptr;   // 1x1 pbuffer, only when surfaceless is unsupported
+    int glMajor = 0;
+    int glMinor = 0;
+};
+
+// Creates a core profile context (4.3, falling back to 3.3) and makes it
+// current. Uses the surfaceless platform and no surface when available, and a
+// pbuffer otherwise. Rendering must go to a framebuffer object.
+bool createHeadlessContext(HeadlessContext& headless);
+void destroyHeadlessContext(HeadlessContext& headless);
+
+// GL function loader for gladLoadGLLoader.
+void* headlessGetProcAddress(const char* name);
+
+#endif // HEADLESS_CONTEXT_H
@@ -0,0 +1,165 @@
+// image_writer.cpp
+// PPM, PNG (stored deflate) and Y4M output.
+
+#include "image_writer.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+struct Crc32Table {
+    uint32_t entries[256];
+    Crc32Table() {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            entries[n] = c;
+        }
+    }
+};
+
+uint32_t crc32Update(uint32_t crc, const unsigned char* data, size_t length) {
+    static const Crc32Table table; // thread-safe initialisation; the capture worker writes PNGs
+    for (size_t i = 0; i < length; ++i)
+        crc = table.entries[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+void appendBigEndian(std::vector<unsigned char>& out, uint32_t value) {
+    out.push_back(static_cast<unsigned char>(value >> 24));
+    out.push_back(static_cast<unsigned char>(value >> 16));
+    out.push_back(static_cast<unsigned char>(value >> 8));
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+void writeChunk(std::ostream& out, const char* type, const std::vector<unsigned char>& data) {
+    std::vector<unsigned char> header;
+    appendBigEndian(header, static_cast<uint32_t>(data.size()));
+    header.insert(header.end(), type, type + 4);
+    uint32_t crc = crc32Update(0xffffffffu, header.data() + 4, 4);
+    crc = crc32Update(crc, data.data(), data.size()) ^ 0xffffffffu;
+    std::vector<unsigned char> footer;
+    appendBigEndian(footer, crc);
+    out.write(reinterpret_cast<const char*>(header.data()), header.size());
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    out.write(reinterpret_cast<const char*>(footer.data()), footer.size());
+}
+
+unsigned char clampByte(float v) {
+    return static_cast<unsigned char>(v < 0.0f ? 0.0f : (v > 255.0f ? 255.0f : v + 0.5f));
+}
+
+} // namespace
+
+bool writePpm(const std::string& path, int width, int height, const std::vector<unsigned char>& rgb) {
+    std::ofstream file(path.c_str(), std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open " << path << " for writing" << std::endl;
+        return false;
+    }
+    file << "P6\n" << width << " " << height << "\n255\n";
+    file.write(reinterpret_cast<const char*>(rgb.data()), static_cast<std::streamsize>(rgb.size()));
+    return static_cast<bool>(file);
+}
+
+bool writePng(const std::string& path, int width, int height, const std::vector<unsigned char>& rgb) {
+    std::ofstream file(path.c_str(), std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open " << path << " for writing" << std::endl;
+        return false;
+    }
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+    std::vector<unsigned char> header;
+    appendBigEndian(header, static_cast<uint32_t>(width));
+    appendBigEndian(header, static_cast<uint32_t>(height));
+    const unsigned char headerTail[5] = { 8, 2, 0, 0, 0 }; // 8-bit RGB, deflate, no filter, no interlace
+    header.insert(header.end(), headerTail, headerTail + 5);
+    writeChunk(file, "IHDR", header);
+
+    // Scanlines with filter type 0, wrapped in a zlib stream of stored blocks.
+    const size_t rowBytes = static_cast<size_t>(width) * 3;
+    std::vector<unsigned char> raw((rowBytes + 1) * height);
+    for (int y = 0; y < height; ++y) {
+        raw[y * (rowBytes + 1)] = 0;
+        std::memcpy(&raw[y * (rowBytes + 1) + 1], &rgb[y * rowBytes], rowBytes);
+    }
+    const size_t maxBlock = 65535;
+    std::vector<unsigned char> data;
+    data.reserve(2 + raw.size() + (raw.size() / maxBlock + 1) * 5 + 4);
+    data.push_back(0x78);
+    data.push_back(0x01);
+    for (size_t offset = 0; offset < raw.size() || offset == 0; offset += maxBlock) {
+        size_t blockSize = raw.size() - offset < maxBlock ? raw.size() - offset : maxBlock;
+        data.push_back(offset + blockSize == raw.size() ? 1 : 0);
+        data.push_back(static_cast<unsigned char>(blockSize));
+        data.push_back(static_cast<unsigned char>(blockSize >> 8));
+        data.push_back(static_cast<unsigned char>(~blockSize));
+        data.push_back(static_cast<unsigned char>(~blockSize >> 8));
+        data.insert(data.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+        if (raw.empty())
+            break;
+    }
+    // Adler-32, reducing only every 5552 bytes (the most that cannot overflow).
+    uint32_t adlerA = 1, adlerB = 0;
+    for (size_t offset = 0; offset < raw.size(); offset += 5552) {
+        size_t end = raw.size() - offset < 5552 ? raw.size() : offset + 5552;
+        for (size_t i = offset; i < end; ++i) {
+            adlerA += raw[i];
+            adlerB += adlerA;
+        }
+        adlerA %= 65521;
+        adlerB %= 65521;
+    }
+    appendBigEndian(data, (adlerB << 16) | adlerA);
+    writeChunk(file, "IDAT", data);
+    writeChunk(file, "IEND", std::vector<unsigned char>());
+    return static_cast<bool>(file);
+}
+
+void writeY4mHeader(std::ostream& out, int width, int height, int framesPerSecond) {
+    out << "YUV4MPEG2 W" << (width & ~1) << " H" << (height & ~1) << " F" << framesPerSecond
+        << ":1 Ip A1:1 C420jpeg XYSCSS=420JPEG\n";
+}
+
+void writeY4mFrame(std::ostream& out, int width, int height, const std::vector<unsigned char>& rgb) {
+    const int w = width & ~1;
+    const int h = height & ~1;
+    std::vector<unsigned char> planes(static_cast<size_t>(w) * h * 3 / 2);
+    unsigned char* yPlane = planes.data();
+    unsigned char* uPlane = yPlane + w * h;
+    unsigned char* vPlane = uPlane + (w / 2) * (h / 2);
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            const unsigned char* p = &rgb[(static_cast<size_t>(y) * width + x) * 3];
+            yPlane[y * w + x] = clampByte(0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2]);
+        }
+    }
+    // Chroma from the average of each 2x2 block.
+    for (int y = 0; y < h; y += 2) {
+        for (int x = 0; x < w; x += 2) {
+            float r = 0.0f, g = 0.0f, b = 0.0f;
+            for (int dy = 0; dy < 2; ++dy) {
+                for (int dx = 0; dx < 2; ++dx) {
+                    const unsigned char* p = &rgb[(static_cast<size_t>(y + dy) * width + x + dx) * 3];
+                    r += p[0];
+                    g += p[1];
+                    b += p[2];
+                }
+            }
+            r *= 0.25f;
+            g *= 0.25f;
+            b *= 0.25f;
+            const int c = (y / 2) * (w / 2) + x / 2;
+            uPlane[c] = clampByte(128.0f - 0.168736f * r - 0.331264f * g + 0.5f * b);
+            vPlane[c] = clampByte(128.0f + 0.5f * r - 0.418688f * g - 0.081312f * b);
+        }
+    }
+    out << "FRAME\n";
+    out.write(reinterpret_cast<const char*>(planes.data()), static_cast<std::streamsize>(planes.size()));
+}
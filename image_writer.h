@@ -0,0 +1,24 @@
+// image_writer.h
+// Minimal image and video file output for rendered frames. All functions take
+// tightly packed 8-bit RGB rows, top row first.
+
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Binary PPM (P6).
+bool writePpm(const std::string& path, int width, int height, const std::vector<unsigned char>& rgb);
+
+// 8-bit RGB PNG. The image data goes into stored (uncompressed) deflate
+// blocks, trading file size for encode speed and no zlib dependency.
+bool writePng(const std::string& path, int width, int height, const std::vector<unsigned char>& rgb);
+
+// YUV4MPEG2 stream: one header, then one frame per call, converted to 4:2:0
+// (BT.601, full range). Odd dimensions drop the last row/column.
+void writeY4mHeader(std::ostream& out, int width, int height, int framesPerSecond);
+void writeY4mFrame(std::ostream& out, int width, int height, const std::vector<unsigned char>& rgb);
+
+#endif // IMAGE_WRITER_H
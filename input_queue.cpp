@@ -0,0 +1,45 @@
+// input_queue.cpp
+// Ring push/pop and draining with cursor-move coalescing.
+
+#include "input_queue.h"
+
+bool pushInputEvent(InputQueue& queue, const InputEvent& event) {
+    const size_t head = queue.head.load(std::memory_order_relaxed);
+    if (head - queue.tail.load(std::memory_order_acquire) == kInputQueueCapacity) {
+        queue.dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    queue.events[head % kInputQueueCapacity] = event;
+    // Publishes the event written above.
+    queue.head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+bool popInputEvent(InputQueue& queue, InputEvent& event) {
+    const size_t tail = queue.tail.load(std::memory_order_relaxed);
+    if (tail == queue.head.load(std::memory_order_acquire))
+        return false;
+    event = queue.events[tail % kInputQueueCapacity];
+    // Hands the slot back to the producer only after it has been copied out.
+    queue.tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+bool inputQueueEmpty(const InputQueue& queue) {
+    return queue.tail.load(std::memory_order_relaxed) == queue.head.load(std::memory_order_acquire);
+}
+
+void drainInputEvents(InputQueue& queue, std::vector<InputEvent>& events) {
+    events.clear();
+    InputEvent event;
+    while (popInputEvent(queue, event)) {
+        ++queue.consumed;
+        if (event.type == InputEventType::CursorMove && !events.empty() &&
+            events.back().type == InputEventType::CursorMove) {
+            events.back() = event;
+            ++queue.coalesced;
+            continue;
+        }
+        events.push_back(event);
+    }
+}
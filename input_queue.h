@@ -0,0 +1,58 @@
+// input_queue.h
+// Timestamped input events passed from the GLFW callbacks to the simulation
+// through a lock-free single-producer, single-consumer ring. Callbacks only
+// record what happened; the simulation drains the ring at a step boundary,
+// so nothing touches the physics world from inside a callback, and runs of
+// cursor moves collapse into one event per step.
+
+#ifndef INPUT_QUEUE_H
+#define INPUT_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Events the ring holds; more than a frame's worth of input at any rate GLFW
+// reports it. A power of two.
+const size_t kInputQueueCapacity = 1024;
+
+enum class InputEventType : uint8_t {
+    CursorMove,
+    MouseButton,
+    Key
+};
+
+struct InputEvent {
+    InputEventType type = InputEventType::CursorMove;
+    double time = 0.0;      // glfwGetTime() in the callback
+    double x = 0.0;         // cursor position; also recorded for buttons
+    double y = 0.0;
+    int code = 0;           // mouse button or key
+    int action = 0;         // GLFW_PRESS, GLFW_RELEASE or GLFW_REPEAT
+    int mods = 0;
+};
+
+struct InputQueue {
+    InputEvent events[kInputQueueCapacity];
+    // Indices only grow; the slot is index % capacity. Each is written by one
+    // side only, and kept on its own cache line.
+    alignas(64) std::atomic<size_t> head{0};    // next event the producer writes
+    alignas(64) std::atomic<size_t> tail{0};    // next event the consumer reads
+    std::atomic<uint64_t> dropped{0};           // pushes that found the ring full
+    uint64_t consumed = 0;                      // consumer side
+    uint64_t coalesced = 0;                     // cursor moves folded into a later one
+};
+
+// Producer side. Returns false, and counts a drop, when the ring is full.
+bool pushInputEvent(InputQueue& queue, const InputEvent& event);
+// Consumer side.
+bool popInputEvent(InputQueue& queue, InputEvent& event);
+bool inputQueueEmpty(const InputQueue& queue);
+
+// Consumer side: moves every queued event into events (cleared first), in
+// order, with each run of consecutive cursor moves replaced by its last one.
+// Positions are absolute, so the last move still carries the whole motion.
+void drainInputEvents(InputQueue& queue, std::vector<InputEvent>& events);
+
+#endif // INPUT_QUEUE_H
@@ -0,0 +1,285 @@
+// job_system.cpp
+// Worker threads, deque stealing, counters and the Bullet task scheduler hooks.
+
+#include "job_system.h"
+
+#include <algorithm>
+
+#include "frame_arena.h"
+
+namespace {
+
+// Queue of the calling thread: 0 for the main thread, i + 1 for worker i.
+thread_local size_t currentQueue = 0;
+
+// Idle workers retry this many times before going to sleep, so bursts of
+// small jobs (a parallel-for every few hundred microseconds) do not pay for a
+// wake-up each time.
+const int kIdleSpins = 64;
+
+} // namespace
+
+JobSystem::JobSystem()
+    : btITaskScheduler("JobSystem"), activeThreads(1), queuedJobs(0), sleepingWorkers(0), jobsRun(0), jobsStolen(0),
+      stopping(false) {
+    queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue));
+}
+
+JobSystem::~JobSystem() {
+    stop();
+}
+
+void JobSystem::start(int workerCount) {
+    stop();
+    // Bullet numbers the threads that run its work and caps them.
+    workerCount = std::max(0, std::min(workerCount, getMaxNumThreads() - 1));
+    stopping = false;
+    queues.resize(1);
+    for (int i = 0; i < workerCount; ++i)
+        queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue));
+    activeThreads = workerCount + 1;
+    for (int i = 0; i < workerCount; ++i)
+        workers.push_back(std::thread(&JobSystem::workerLoop, this, static_cast<size_t>(i + 1)));
+}
+
+void JobSystem::stop() {
+    if (workers.empty())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+    workers.clear();
+    queues.resize(1);
+    queues[0]->jobs.clear();
+    backgroundQueue.jobs.clear();
+    queuedJobs = 0;
+    activeThreads = 1;
+}
+
+void JobSystem::run(const Job& job, JobCounter* counter) {
+    if (counter)
+        ++counter->pending;
+    QueuedJob queued;
+    queued.job = job;
+    queued.counter = counter;
+    push(queued);
+}
+
+void JobSystem::runAfter(JobCounter& dependency, const Job& job, JobCounter* counter) {
+    if (counter)
+        ++counter->pending;
+    {
+        std::lock_guard<std::mutex> lock(dependency.mutex);
+        if (dependency.pending.load() > 0) {
+            JobCounter::Continuation continuation;
+            continuation.job = job;
+            continuation.counter = counter;
+            dependency.continuations.push_back(continuation);
+            return;
+        }
+    }
+    QueuedJob queued;
+    queued.job = job;
+    queued.counter = counter;
+    push(queued);
+}
+
+void JobSystem::runBackground(const Job& job, JobCounter* counter) {
+    if (counter)
+        ++counter->pending;
+    QueuedJob queued;
+    queued.job = job;
+    queued.counter = counter;
+    // With no workers nothing would pick it up until someone waits on it.
+    if (workers.empty()) {
+        execute(queued);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(backgroundQueue.mutex);
+        backgroundQueue.jobs.push_back(queued);
+    }
+    ++queuedJobs;
+    wakeWorker();
+}
+
+void JobSystem::wait(JobCounter& counter) {
+    // Without active workers nobody else will run background jobs.
+    const bool includeBackground = activeThreads.load() < 2;
+    QueuedJob job;
+    while (counter.pending.load() > 0) {
+        if (takeJob(currentQueue, includeBackground, job))
+            execute(job);
+        else
+            std::this_thread::yield();
+    }
+    // The last job may still hold the counter's lock.
+    std::lock_guard<std::mutex> lock(counter.mutex);
+}
+
+void JobSystem::parallelFor(int begin, int end, int grain, const std::function<void(int, int)>& body) {
+    grain = std::max(grain, 1);
+    if (end - begin <= grain || activeThreads.load() < 2) {
+        if (begin < end)
+            body(begin, end);
+        return;
+    }
+    JobCounter counter;
+    for (int first = begin; first < end; first += grain) {
+        const int last = std::min(first + grain, end);
+        run([&body, first, last]() { body(first, last); }, &counter);
+    }
+    wait(counter);
+}
+
+JobSystemStats JobSystem::getStats() const {
+    JobSystemStats stats;
+    stats.threads = activeThreads.load();
+    stats.jobsRun = jobsRun.load();
+    stats.jobsStolen = jobsStolen.load();
+    return stats;
+}
+
+int JobSystem::getMaxNumThreads() const {
+    return BT_MAX_THREAD_COUNT;
+}
+
+int JobSystem::getNumThreads() const {
+    return activeThreads.load();
+}
+
+void JobSystem::setNumThreads(int numThreads) {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    activeThreads = std::max(1, std::min(numThreads, static_cast<int>(workers.size()) + 1));
+    wake.notify_all();
+}
+
+void JobSystem::parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) {
+    parallelFor(iBegin, iEnd, grainSize, [&body](int first, int last) { body.forLoop(first, last); });
+}
+
+btScalar JobSystem::parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body) {
+    grainSize = std::max(grainSize, 1);
+    // Bullet sums once or more per step; the partials are frame scratch.
+    FrameVector<btScalar> sums((std::max(iEnd - iBegin, 0) + grainSize - 1) / grainSize, btScalar(0),
+                               FrameAllocator<btScalar>(threadFrameArena()));
+    parallelFor(0, static_cast<int>(sums.size()), 1, [&](int first, int last) {
+        for (int i = first; i < last; ++i)
+            sums[i] = body.sumLoop(iBegin + i * grainSize, std::min(iBegin + (i + 1) * grainSize, iEnd));
+    });
+    btScalar sum = 0;
+    for (btScalar partial : sums)
+        sum += partial;
+    return sum;
+}
+
+void JobSystem::push(QueuedJob job) {
+    WorkQueue& queue = *queues[currentQueue < queues.size() ? currentQueue : 0];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(job);
+    }
+    ++queuedJobs;
+    wakeWorker();
+}
+
+void JobSystem::wakeWorker() {
+    // A worker counts itself as sleeping before it rechecks queuedJobs, so
+    // either it sees the new job or we see it sleeping.
+    if (sleepingWorkers.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wake.notify_one();
+    }
+}
+
+bool JobSystem::takeJob(size_t self, bool includeBackground, QueuedJob& job) {
+    // Own queue first, newest job (still warm in cache).
+    {
+        WorkQueue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = own.jobs.back();
+            own.jobs.pop_back();
+            --queuedJobs;
+            return true;
+        }
+    }
+    // Then the oldest job of another queue, which tends to be the biggest
+    // piece left of whatever it belongs to.
+    for (size_t i = 1; i < queues.size(); ++i) {
+        WorkQueue& victim = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = victim.jobs.front();
+            victim.jobs.pop_front();
+            --queuedJobs;
+            ++jobsStolen;
+            return true;
+        }
+    }
+    if (includeBackground) {
+        std::lock_guard<std::mutex> lock(backgroundQueue.mutex);
+        if (!backgroundQueue.jobs.empty()) {
+            job = backgroundQueue.jobs.front();
+            backgroundQueue.jobs.pop_front();
+            --queuedJobs;
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::execute(QueuedJob& job) {
+    job.job();
+    ++jobsRun;
+    JobCounter* counter = job.counter;
+    job = QueuedJob();
+    if (!counter)
+        return;
+    // Counted down under the lock, so runAfter sees either the old count or
+    // the released continuations, and wait does not return (and let the
+    // counter go out of scope) before this thread is done with it.
+    std::vector<JobCounter::Continuation> continuations;
+    {
+        std::lock_guard<std::mutex> lock(counter->mutex);
+        if (counter->pending.fetch_sub(1) == 1)
+            continuations.swap(counter->continuations);
+    }
+    for (const JobCounter::Continuation& continuation : continuations) {
+        QueuedJob queued;
+        queued.job = continuation.job;
+        queued.counter = continuation.counter;
+        push(queued);
+    }
+}
+
+void JobSystem::workerLoop(size_t queue) {
+    currentQueue = queue;
+    QueuedJob job;
+    int idle = 0;
+    while (!stopping.load()) {
+        // Parked workers (beyond setNumThreads) take nothing; waiting threads
+        // steal anything left in their queues.
+        const bool active = static_cast<int>(queue) < activeThreads.load();
+        if (active && takeJob(queue, true, job)) {
+            execute(job);
+            idle = 0;
+            continue;
+        }
+        if (active && ++idle < kIdleSpins) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        ++sleepingWorkers;
+        wake.wait(lock, [this, queue]() {
+            return stopping.load() || (queuedJobs.load() > 0 && static_cast<int>(queue) < activeThreads.load());
+        });
+        --sleepingWorkers;
+        idle = 0;
+    }
+}
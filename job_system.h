@@ -0,0 +1,124 @@
+// job_system.h
+// Work-stealing job scheduler shared by physics, culling, render prep and
+// frame capture. Every worker owns a deque: it pushes and pops its own jobs at
+// the back, and idle workers steal from the front of the others'. Jobs count
+// down a JobCounter when they finish; waiting on a counter runs other jobs
+// rather than blocking, and a job can be queued to start once a counter
+// reaches zero. The scheduler is also Bullet's task scheduler, so the
+// multithreaded dynamics world runs on the same threads instead of its own.
+
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <LinearMath/btThreads.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::function<void()> Job;
+
+class JobSystem;
+
+// Unfinished jobs counted against it, and the jobs waiting for it to drain.
+struct JobCounter {
+    JobCounter() : pending(0) {}
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool done() const { return pending.load() == 0; }
+
+private:
+    friend class JobSystem;
+    struct Continuation {
+        Job job;
+        JobCounter* counter;
+    };
+    std::atomic<int> pending;
+    std::mutex mutex;
+    std::vector<Continuation> continuations;
+};
+
+struct JobSystemStats {
+    int threads = 1;            // workers plus the main thread
+    uint64_t jobsRun = 0;
+    uint64_t jobsStolen = 0;
+};
+
+class JobSystem : public btITaskScheduler {
+public:
+    JobSystem();
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Starts workerCount worker threads; the thread that calls start counts as
+    // one more, running jobs whenever it waits. 0 runs everything inline.
+    void start(int workerCount);
+    // Joins the workers. Jobs still queued are dropped.
+    void stop();
+
+    // Queues job; counter, when given, counts it until it has run.
+    void run(const Job& job, JobCounter* counter = nullptr);
+    // Queues job once dependency reaches zero (at once if it already has).
+    void runAfter(JobCounter& dependency, const Job& job, JobCounter* counter = nullptr);
+    // Queues a long-running job (encoding, I/O) that only workers pick up, so
+    // waiting on frame work never gets stuck behind it. Without workers it
+    // runs inline, before returning.
+    void runBackground(const Job& job, JobCounter* counter = nullptr);
+    // Runs queued jobs until counter reaches zero.
+    void wait(JobCounter& counter);
+
+    // Runs body over [begin, end) in ranges of at most grain items, in
+    // parallel, and returns when all have run.
+    void parallelFor(int begin, int end, int grain, const std::function<void(int, int)>& body);
+
+    JobSystemStats getStats() const;
+
+    // btITaskScheduler. setNumThreads only parks or wakes workers already
+    // started: Bullet sizes per-thread data by the thread count when the world
+    // is created, so the count must never grow past that.
+    int getMaxNumThreads() const override;
+    int getNumThreads() const override;
+    void setNumThreads(int numThreads) override;
+    void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) override;
+    btScalar parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body) override;
+
+private:
+    struct QueuedJob {
+        Job job;
+        JobCounter* counter = nullptr;
+    };
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<QueuedJob> jobs;
+    };
+
+    void push(QueuedJob job);
+    void wakeWorker();
+    bool takeJob(size_t self, bool includeBackground, QueuedJob& job);
+    void execute(QueuedJob& job);
+    void workerLoop(size_t queue);
+
+    // Queue 0 belongs to the main (and any other non-worker) thread, queue
+    // i + 1 to worker i.
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    WorkQueue backgroundQueue;
+    std::vector<std::thread> workers;
+    std::atomic<int> activeThreads;
+    std::atomic<int> queuedJobs;
+    std::atomic<int> sleepingWorkers;
+    std::atomic<uint64_t> jobsRun;
+    std::atomic<uint64_t> jobsStolen;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<bool> stopping;
+};
+
+#endif // JOB_SYSTEM_H
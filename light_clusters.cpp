@@ -0,0 +1,284 @@
+// light_clusters.cpp
+// Light culling, cluster assignment and the texture buffer uploads.
+
+#include "light_clusters.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define LIGHT_CLUSTERS_SSE 1
+#endif
+
+namespace {
+
+const uint32_t kDroppedPair = 0xffffffffu;
+
+// Orphans the buffer and uploads count elements, doubling its capacity when
+// they do not fit. Growing reattaches the texture to the new storage.
+void uploadTextureBuffer(GLuint buffer, GLuint texture, GLenum format, GLsizeiptr& capacity, GLsizeiptr count,
+                         size_t elementSize, const void* data) {
+    const bool grow = count > capacity;
+    if (grow)
+        capacity = count * 2;
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, capacity * elementSize, nullptr, GL_STREAM_DRAW);
+    if (count > 0)
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, count * elementSize, data);
+    if (grow) {
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+    }
+}
+
+// Transforms the light centers in grid.viewX/Y/Z (world space on entry) to
+// view space and appends the lights whose sphere touches the frustum to
+// grid.visible. A sphere is outside a side plane when its signed distance,
+// e.g. (xScale * |x| - depth) / sqrt(xScale^2 + 1), exceeds its radius.
+// count is a multiple of four; padding lanes have no radius and always fail.
+void cullLights(LightClusterGrid& grid, size_t count, const glm::mat4& view, float xScale, float yScale,
+                float nearPlane, float farPlane) {
+    const float xInvLength = 1.0f / std::sqrt(xScale * xScale + 1.0f);
+    const float yInvLength = 1.0f / std::sqrt(yScale * yScale + 1.0f);
+    float* vx = grid.viewX.data();
+    float* vy = grid.viewY.data();
+    float* vz = grid.viewZ.data();
+    const float* r = grid.radii.data();
+    size_t i = 0;
+#ifdef LIGHT_CLUSTERS_SSE
+    const __m128 m00 = _mm_set1_ps(view[0][0]), m10 = _mm_set1_ps(view[1][0]);
+    const __m128 m20 = _mm_set1_ps(view[2][0]), m30 = _mm_set1_ps(view[3][0]);
+    const __m128 m01 = _mm_set1_ps(view[0][1]), m11 = _mm_set1_ps(view[1][1]);
+    const __m128 m21 = _mm_set1_ps(view[2][1]), m31 = _mm_set1_ps(view[3][1]);
+    const __m128 m02 = _mm_set1_ps(view[0][2]), m12 = _mm_set1_ps(view[1][2]);
+    const __m128 m22 = _mm_set1_ps(view[2][2]), m32 = _mm_set1_ps(view[3][2]);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 xs = _mm_set1_ps(xScale), ys = _mm_set1_ps(yScale);
+    const __m128 xInv = _mm_set1_ps(xInvLength), yInv = _mm_set1_ps(yInvLength);
+    const __m128 nearV = _mm_set1_ps(nearPlane), farV = _mm_set1_ps(farPlane);
+    const __m128 zero = _mm_setzero_ps();
+    for (; i < count; i += 4) {
+        const __m128 x = _mm_loadu_ps(vx + i), y = _mm_loadu_ps(vy + i), z = _mm_loadu_ps(vz + i);
+        const __m128 radius = _mm_loadu_ps(r + i);
+        const __m128 tx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, x), _mm_mul_ps(m10, y)), _mm_add_ps(_mm_mul_ps(m20, z), m30));
+        const __m128 ty = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m01, x), _mm_mul_ps(m11, y)), _mm_add_ps(_mm_mul_ps(m21, z), m31));
+        const __m128 tz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m02, x), _mm_mul_ps(m12, y)), _mm_add_ps(_mm_mul_ps(m22, z), m32));
+        _mm_storeu_ps(vx + i, tx);
+        _mm_storeu_ps(vy + i, ty);
+        _mm_storeu_ps(vz + i, tz);
+        const __m128 depth = _mm_xor_ps(tz, signMask);
+        const __m128 sideX = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(xs, _mm_andnot_ps(signMask, tx)), depth), xInv);
+        const __m128 sideY = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(ys, _mm_andnot_ps(signMask, ty)), depth), yInv);
+        __m128 outside = _mm_or_ps(_mm_cmple_ps(radius, zero), _mm_cmpgt_ps(sideX, radius));
+        outside = _mm_or_ps(outside, _mm_cmpgt_ps(sideY, radius));
+        outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(depth, radius), nearV));
+        outside = _mm_or_ps(outside, _mm_cmpgt_ps(_mm_sub_ps(depth, radius), farV));
+        int inside = ~_mm_movemask_ps(outside) & 0xf;
+        while (inside) {
+            int lane = 0;
+            while (!(inside & (1 << lane)))
+                ++lane;
+            inside &= ~(1 << lane);
+            grid.visible.push_back(static_cast<uint32_t>(i + lane));
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        const glm::vec4 p = view * glm::vec4(vx[i], vy[i], vz[i], 1.0f);
+        vx[i] = p.x;
+        vy[i] = p.y;
+        vz[i] = p.z;
+        const float depth = -p.z;
+        if (r[i] <= 0.0f || (xScale * std::fabs(p.x) - depth) * xInvLength > r[i] ||
+            (yScale * std::fabs(p.y) - depth) * yInvLength > r[i] || depth + r[i] < nearPlane || depth - r[i] > farPlane)
+            continue;
+        grid.visible.push_back(static_cast<uint32_t>(i));
+    }
+}
+
+// Tiles covered by the view-space interval [low, high] (x or y) over the depth
+// interval [nearDepth, farDepth]. Returns false when it is off screen.
+bool tileRange(float low, float high, float nearDepth, float farDepth, float scale, int tiles, int& first, int& last) {
+    const float ndcLow = scale * (low >= 0.0f ? low / farDepth : low / nearDepth);
+    const float ndcHigh = scale * (high >= 0.0f ? high / nearDepth : high / farDepth);
+    if (ndcHigh < -1.0f || ndcLow > 1.0f)
+        return false;
+    first = std::max(0, static_cast<int>(std::floor((ndcLow * 0.5f + 0.5f) * tiles)));
+    last = std::min(tiles - 1, static_cast<int>(std::floor((ndcHigh * 0.5f + 0.5f) * tiles)));
+    return first <= last;
+}
+
+} // namespace
+
+LightClusterGrid createLightClusterGrid() {
+    LightClusterGrid grid;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &grid.maxTexels);
+    glGenBuffers(1, &grid.lightBuffer);
+    glGenBuffers(1, &grid.clusterBuffer);
+    glGenBuffers(1, &grid.indexBuffer);
+    glGenTextures(1, &grid.lightTexture);
+    glGenTextures(1, &grid.clusterTexture);
+    glGenTextures(1, &grid.indexTexture);
+    // Empty lists until the first build, so unlit frames can sample them.
+    grid.clusterRanges.assign(kClusterCount * 2, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, grid.clusterBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, grid.clusterRanges.size() * sizeof(uint32_t), grid.clusterRanges.data(), GL_STREAM_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, grid.clusterTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, grid.clusterBuffer);
+    uploadTextureBuffer(grid.lightBuffer, grid.lightTexture, GL_RGBA32F, grid.lightCapacity, 64, sizeof(glm::vec4), nullptr);
+    uploadTextureBuffer(grid.indexBuffer, grid.indexTexture, GL_R32UI, grid.indexCapacity, 256, sizeof(uint32_t), nullptr);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    return grid;
+}
+
+void destroyLightClusterGrid(LightClusterGrid& grid) {
+    glDeleteTextures(1, &grid.lightTexture);
+    glDeleteTextures(1, &grid.clusterTexture);
+    glDeleteTextures(1, &grid.indexTexture);
+    glDeleteBuffers(1, &grid.lightBuffer);
+    glDeleteBuffers(1, &grid.clusterBuffer);
+    glDeleteBuffers(1, &grid.indexBuffer);
+    grid = LightClusterGrid();
+}
+
+void buildLightClusters(LightClusterGrid& grid, const std::vector<PointLight>& lights, const glm::mat4& view,
+                        const glm::mat4& projection, float nearPlane, float farPlane, int viewportWidth,
+                        int viewportHeight) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const size_t count = lights.size();
+    const size_t padded = (count + 3) & ~static_cast<size_t>(3);
+    grid.viewX.resize(padded);
+    grid.viewY.resize(padded);
+    grid.viewZ.resize(padded);
+    grid.radii.resize(padded);
+    for (size_t i = 0; i < count; ++i) {
+        grid.viewX[i] = lights[i].position.x;
+        grid.viewY[i] = lights[i].position.y;
+        grid.viewZ[i] = lights[i].position.z;
+        grid.radii[i] = lights[i].radius;
+    }
+    for (size_t i = count; i < padded; ++i) {
+        grid.viewX[i] = grid.viewY[i] = grid.viewZ[i] = 0.0f;
+        grid.radii[i] = -1.0f;
+    }
+    const float xScale = projection[0][0];
+    const float yScale = projection[1][1];
+    grid.visible.clear();
+    cullLights(grid, padded, view, xScale, yScale, nearPlane, farPlane);
+
+    size_t dropped = 0;
+    const size_t maxLights = static_cast<size_t>(grid.maxTexels / 2);
+    if (grid.visible.size() > maxLights) {
+        dropped += grid.visible.size() - maxLights;
+        grid.visible.resize(maxLights);
+    }
+
+    // Exponential slices: slice s spans nearPlane * (far/near)^(s/S) onward.
+    const float sliceScale = kClusterSlices / std::log(farPlane / nearPlane);
+    const float sliceBias = -std::log(nearPlane) * sliceScale;
+    float sliceBounds[kClusterSlices + 1];
+    for (int s = 0; s <= kClusterSlices; ++s)
+        sliceBounds[s] = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(s) / kClusterSlices);
+    sliceBounds[kClusterSlices] = farPlane;
+
+    // Every (cluster, light) overlap, in visible light order.
+    grid.pairClusters.clear();
+    grid.pairLights.clear();
+    for (size_t v = 0; v < grid.visible.size(); ++v) {
+        const uint32_t light = grid.visible[v];
+        const float cx = grid.viewX[light];
+        const float cy = grid.viewY[light];
+        const float depth = -grid.viewZ[light];
+        const float radius = grid.radii[light];
+        const float d0 = std::max(depth - radius, nearPlane);
+        const float d1 = std::min(depth + radius, farPlane);
+        const int s0 = std::max(0, static_cast<int>(std::floor(std::log(d0) * sliceScale + sliceBias)));
+        const int s1 = std::min(kClusterSlices - 1, static_cast<int>(std::floor(std::log(d1) * sliceScale + sliceBias)));
+        for (int s = s0; s <= s1; ++s) {
+            const float sliceNear = std::max(sliceBounds[s], d0);
+            const float sliceFar = std::min(sliceBounds[s + 1], d1);
+            // The widest cross-section of the sphere within the slice.
+            const float dz = depth < sliceNear ? sliceNear - depth : (depth > sliceFar ? depth - sliceFar : 0.0f);
+            const float sectionRadius = std::sqrt(std::max(radius * radius - dz * dz, 0.0f));
+            int x0, x1, y0, y1;
+            if (!tileRange(cx - sectionRadius, cx + sectionRadius, sliceNear, sliceFar, xScale, kClusterTilesX, x0, x1) ||
+                !tileRange(cy - sectionRadius, cy + sectionRadius, sliceNear, sliceFar, yScale, kClusterTilesY, y0, y1))
+                continue;
+            for (int y = y0; y <= y1; ++y) {
+                for (int x = x0; x <= x1; ++x) {
+                    grid.pairClusters.push_back(static_cast<uint32_t>((s * kClusterTilesY + y) * kClusterTilesX + x));
+                    grid.pairLights.push_back(static_cast<uint32_t>(v));
+                }
+            }
+        }
+    }
+
+    // Counting sort of the pairs by cluster into contiguous index lists.
+    std::vector<uint32_t>& ranges = grid.clusterRanges;
+    ranges.assign(kClusterCount * 2, 0);
+    size_t total = 0;
+    const size_t maxIndices = static_cast<size_t>(grid.maxTexels);
+    for (size_t p = 0; p < grid.pairClusters.size(); ++p) {
+        uint32_t& clusterCount = ranges[grid.pairClusters[p] * 2 + 1];
+        if (clusterCount >= kMaxLightsPerCluster || total >= maxIndices) {
+            grid.pairClusters[p] = kDroppedPair;
+            ++dropped;
+            continue;
+        }
+        ++clusterCount;
+        ++total;
+    }
+    uint32_t first = 0;
+    uint32_t maxClusterLights = 0;
+    for (int c = 0; c < kClusterCount; ++c) {
+        ranges[c * 2] = first;
+        first += ranges[c * 2 + 1];
+        maxClusterLights = std::max(maxClusterLights, ranges[c * 2 + 1]);
+        ranges[c * 2 + 1] = 0;   // refilled as the scatter cursor
+    }
+    grid.indices.resize(total);
+    for (size_t p = 0; p < grid.pairClusters.size(); ++p) {
+        const uint32_t cluster = grid.pairClusters[p];
+        if (cluster == kDroppedPair)
+            continue;
+        grid.indices[ranges[cluster * 2] + ranges[cluster * 2 + 1]++] = grid.pairLights[p];
+    }
+
+    grid.lightTexels.resize(grid.visible.size() * 2);
+    for (size_t v = 0; v < grid.visible.size(); ++v) {
+        const uint32_t light = grid.visible[v];
+        grid.lightTexels[v * 2] = glm::vec4(grid.viewX[light], grid.viewY[light], grid.viewZ[light], grid.radii[light]);
+        grid.lightTexels[v * 2 + 1] = glm::vec4(lights[light].color, 0.0f);
+    }
+    uploadTextureBuffer(grid.lightBuffer, grid.lightTexture, GL_RGBA32F, grid.lightCapacity,
+                        static_cast<GLsizeiptr>(grid.lightTexels.size()), sizeof(glm::vec4), grid.lightTexels.data());
+    uploadTextureBuffer(grid.indexBuffer, grid.indexTexture, GL_R32UI, grid.indexCapacity,
+                        static_cast<GLsizeiptr>(grid.indices.size()), sizeof(uint32_t), grid.indices.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, grid.clusterBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, ranges.size() * sizeof(uint32_t), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, ranges.size() * sizeof(uint32_t), ranges.data());
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    grid.shaderScale = glm::vec4(static_cast<float>(viewportWidth) / kClusterTilesX,
+                                 static_cast<float>(viewportHeight) / kClusterTilesY, sliceScale, sliceBias);
+    grid.lastVisibleLights = grid.visible.size();
+    grid.lastIndexCount = total;
+    grid.lastMaxClusterLights = maxClusterLights;
+    grid.lastDroppedLights = dropped;
+    grid.lastAssignMilliseconds =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void bindLightClusters(const LightClusterGrid& grid) {
+    glActiveTexture(GL_TEXTURE0 + kLightDataTextureUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, grid.lightTexture);
+    glActiveTexture(GL_TEXTURE0 + kLightClusterTextureUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, grid.clusterTexture);
+    glActiveTexture(GL_TEXTURE0 + kLightIndexTextureUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, grid.indexTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,84 @@
+// light_clusters.h
+// Clustered forward lighting: the view frustum is split into screen tiles and
+// exponential depth slices, point lights are assigned to the clusters they
+// touch on the CPU, and the per-cluster light lists are handed to fragment
+// shaders through texture buffers (GL 3.3).
+
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Cluster grid resolution: screen tiles across and up, depth slices.
+const int kClusterTilesX = 16;
+const int kClusterTilesY = 9;
+const int kClusterSlices = 24;
+const int kClusterCount = kClusterTilesX * kClusterTilesY * kClusterSlices;
+
+// Lights beyond this many in one cluster are dropped (and counted).
+const uint32_t kMaxLightsPerCluster = 256;
+
+// Texture units the clustered shaders sample the three buffers from.
+const GLint kLightDataTextureUnit = 4;     // samplerBuffer uLights
+const GLint kLightClusterTextureUnit = 5;  // usamplerBuffer uLightClusters
+const GLint kLightIndexTextureUnit = 6;    // usamplerBuffer uLightIndices
+
+struct PointLight {
+    glm::vec3 position;   // world space
+    float radius;         // influence ends here
+    glm::vec3 color;      // premultiplied by intensity
+};
+
+struct LightClusterGrid {
+    // Texture buffers: two RGBA32F texels per visible light (view-space
+    // position and radius, color), one RG32UI (first index, count) per
+    // cluster, and the R32UI light index lists.
+    GLuint lightBuffer = 0;
+    GLuint lightTexture = 0;
+    GLuint clusterBuffer = 0;
+    GLuint clusterTexture = 0;
+    GLuint indexBuffer = 0;
+    GLuint indexTexture = 0;
+    GLsizeiptr lightCapacity = 0;   // in texels
+    GLsizeiptr indexCapacity = 0;   // in indices
+    GLint maxTexels = 0;            // GL_MAX_TEXTURE_BUFFER_SIZE
+
+    // Uniforms for the shaders: tile size in pixels, then the depth slice
+    // scale and bias (slice = log(viewDepth) * scale + bias).
+    glm::vec4 shaderScale = glm::vec4(1.0f);
+
+    // Scratch, reused every frame. View-space lights are kept as structure of
+    // arrays so four are transformed and culled per SSE instruction.
+    std::vector<float> viewX, viewY, viewZ, radii;
+    std::vector<uint32_t> visible;
+    std::vector<uint32_t> pairClusters, pairLights;
+    std::vector<uint32_t> clusterRanges;   // (first index, count) per cluster
+    std::vector<uint32_t> indices;
+    std::vector<glm::vec4> lightTexels;
+
+    size_t lastVisibleLights = 0;
+    size_t lastIndexCount = 0;
+    uint32_t lastMaxClusterLights = 0;
+    size_t lastDroppedLights = 0;   // cluster entries over kMaxLightsPerCluster or the texel limit
+    double lastAssignMilliseconds = 0.0;
+};
+
+LightClusterGrid createLightClusterGrid();
+void destroyLightClusterGrid(LightClusterGrid& grid);
+
+// Culls the lights against the view frustum, assigns the survivors to
+// clusters and uploads the buffers. projection must be a symmetric perspective
+// projection with the given near and far planes.
+void buildLightClusters(LightClusterGrid& grid, const std::vector<PointLight>& lights, const glm::mat4& view,
+                        const glm::mat4& projection, float nearPlane, float farPlane, int viewportWidth,
+                        int viewportHeight);
+
+// Binds the three texture buffers to their units.
+void bindLightClusters(const LightClusterGrid& grid);
+
+#endif // LIGHT_CLUSTERS_H
@@ -10,34 +10,427 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
 
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
 
 // --- Include Dear ImGui headers ---
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 
+// --- Engine modules ---
+#include "bullet_allocator.h"
+#include "debug_draw.h"
+#include "engine_config.h"
+#include "entity_world.h"
+#include "frame_arena.h"
+#include "frame_capture.h"
+#include "frame_governor.h"
+#include "frame_profiler.h"
+#include "frustum.h"
+#include "ground_grid.h"
+#include "headless_context.h"
+#include "image_writer.h"
+#include "input_queue.h"
+#include "job_system.h"
+#include "light_clusters.h"
+#include "mesh_arena.h"
+#include "mesh_batch.h"
+#include "physics_pools.h"
+#include "render_queue.h"
+#include "render_target.h"
+#include "scene_generator.h"
+#include "shader_program.h"
+#include "shader_variants.h"
+#include "shadow_cascades.h"
+#include "shape_registry.h"
+#include "sphere_lod.h"
+#include "sphere_impostor.h"
+
 // --- Shader source code using raw string literals with a delimiter ---
-const char* vertexShaderSource = R"SHADER(
+// Shared by every variant set, ahead of each stage's body: the Frame block
+// and, for LIGHTING variants, the clustered forward shading function.
+const char* frameShaderCommonSource = R"SHADER(
+layout(std140) uniform Frame {
+    mat4 uViewProj;
+    mat4 uView;
+    vec4 uLightDirection;   // view space, pointing from the light
+    vec4 uLightColor;
+    vec4 uAmbientColor;
+    vec4 uClusterScale;     // tile size in pixels, depth slice scale and bias
+    ivec4 uClusterGrid;     // tiles across, tiles up, depth slices
+    mat4 uShadowMatrices[3];    // view space -> shadow map coordinates, per cascade
+    vec4 uShadowSplits;         // view depth where each cascade ends; w > 0 enables shadows
+    vec4 uShadowTexelSizes;     // world units per shadow texel, per cascade
+};
+#ifdef LIGHTING
+uniform samplerBuffer uLights;          // per light: view position and radius, color
+uniform usamplerBuffer uLightClusters;  // per cluster: first index, count
+uniform usamplerBuffer uLightIndices;
+uniform sampler2DArrayShadow uShadowMap;
+// Fraction of the directional light reaching a view-space point.
+float directionalShadow(vec3 viewPos, vec3 n)
+{
+    float depth = -viewPos.z;
+    if (uShadowSplits.w <= 0.0 || depth >= uShadowSplits.z)
+        return 1.0;
+    int cascade = depth < uShadowSplits.x ? 0 : (depth < uShadowSplits.y ? 1 : 2);
+    // Offset along the normal by the cascade's texel size against acne.
+    vec4 coord = uShadowMatrices[cascade] * vec4(viewPos + n * (uShadowTexelSizes[cascade] * 1.5), 1.0);
+    return texture(uShadowMap, vec4(coord.xy, float(cascade), coord.z));
+}
+// Directional (shadowed), ambient and the point lights of the fragment's
+// cluster, with position and normal in view space.
+vec3 shadeLit(vec3 albedo, vec3 viewPos, vec3 n, vec2 fragCoord)
+{
+    float diffuse = max(dot(n, -uLightDirection.xyz), 0.0);
+    if (diffuse > 0.0)
+        diffuse *= directionalShadow(viewPos, n);
+    vec3 light = uAmbientColor.rgb + uLightColor.rgb * diffuse;
+    int slice = int(floor(log(-viewPos.z) * uClusterScale.z + uClusterScale.w));
+    ivec3 cell = clamp(ivec3(ivec2(fragCoord / uClusterScale.xy), slice), ivec3(0), uClusterGrid.xyz - 1);
+    uvec2 range = texelFetch(uLightClusters, (cell.z * uClusterGrid.y + cell.y) * uClusterGrid.x + cell.x).xy;
+    for (uint i = 0u; i < range.y; ++i) {
+        int index = int(texelFetch(uLightIndices, int(range.x + i)).x);
+        vec4 positionRadius = texelFetch(uLights, index * 2);
+        vec3 toLight = positionRadius.xyz - viewPos;
+        float distance = length(toLight);
+        float falloff = clamp(1.0 - distance / positionRadius.w, 0.0, 1.0);
+        float diffuse = max(dot(n, toLight / max(distance, 1e-4)), 0.0);
+        light += texelFetch(uLights, index * 2 + 1).rgb * (falloff * falloff * diffuse);
+    }
+    return albedo * light;
+}
+#endif
+)SHADER";
+
+// Samplers of the clustered light buffers, bound when a variant links.
+const ShaderSamplerBinding litShaderSamplers[] = {
+    { "uLights", kLightDataTextureUnit },
+    { "uLightClusters", kLightClusterTextureUnit },
+    { "uLightIndices", kLightIndexTextureUnit },
+    { "uShadowMap", kShadowMapTextureUnit }
+};
+
+// Ground grid: a full-screen triangle; each fragment unprojects its near and
+// far points, intersects that ray with the y = 0 plane and writes the hit depth.
+// LIGHTING shades the plane like any other lit surface.
+const char* groundGridVertexShaderSource = R"SHADER(
+uniform mat4 uInvViewProj;
+out vec3 vNearPoint;
+out vec3 vFarPoint;
+vec3 unproject(vec2 ndc, float z)
+{
+    vec4 p = uInvViewProj * vec4(ndc, z, 1.0);
+    return p.xyz / p.w;
+}
+void main()
+{
+    vec2 ndc = vec2(gl_VertexID == 1 ? 3.0 : -1.0, gl_VertexID == 2 ? 3.0 : -1.0);
+    vNearPoint = unproject(ndc, -1.0);
+    vFarPoint = unproject(ndc, 1.0);
+    gl_Position = vec4(ndc, 0.0, 1.0);
+}
+)SHADER";
+
+const char* groundGridFragmentShaderSource = R"SHADER(
+in vec3 vNearPoint;
+in vec3 vFarPoint;
+uniform vec3 uCameraPos;
+uniform vec3 uGroundColor;
+uniform vec3 uLineColor;
+uniform vec3 uBackgroundColor;
+uniform float uCellSize;
+uniform float uFadeDistance;
+out vec4 FragColor;
+// Coverage of grid lines one pixel wide, fading out where cells shrink
+// below a few pixels so distant lines do not alias into moire.
+float gridLines(vec2 coord)
+{
+    vec2 width = fwidth(coord);
+    vec2 distToLine = abs(fract(coord - 0.5) - 0.5) / max(width, vec2(1e-6));
+    float line = 1.0 - min(min(distToLine.x, distToLine.y), 1.0);
+    return line * (1.0 - clamp(max(width.x, width.y) * 4.0 - 1.0, 0.0, 1.0));
+}
+void main()
+{
+    vec3 ray = vFarPoint - vNearPoint;
+    float t = -vNearPoint.y / ray.y;
+    // Missed the plane, or hit it behind the camera or beyond the far plane.
+    if (t <= 0.0 || t > 1.0)
+        discard;
+    vec3 hit = vNearPoint + ray * t;
+    vec4 clip = uViewProj * vec4(hit, 1.0);
+    gl_FragDepth = 0.5 * (clip.z / clip.w) + 0.5;
+    vec2 coord = hit.xz / uCellSize;
+    float minor = gridLines(coord);
+    float major = gridLines(coord * 0.1);
+    vec3 color = mix(uGroundColor, uLineColor, max(minor * 0.5, major));
+#ifdef LIGHTING
+    color = shadeLit(color, (uView * vec4(hit, 1.0)).xyz, mat3(uView) * vec3(0.0, 1.0, 0.0), gl_FragCoord.xy);
+#endif
+    float fade = clamp(length(hit - uCameraPos) / uFadeDistance, 0.0, 1.0);
+    FragColor = vec4(mix(color, uBackgroundColor, fade * fade), 1.0);
+}
+)SHADER";
+
+// Ground grid variant features.
+const uint32_t kGroundGridFeatureLighting = 1u << 0;
+const ShaderFeature groundGridShaderFeatures[] = {
+    { "LIGHTING", 330 }
+};
+
+// Batched meshes. One body, specialised per bucket by the variant features
+// below: MESH_BATCH_INDIRECT reads the instance from the storage buffer through
+// the index written by the cull shader (GL 4.3) instead of per-instance
+// attributes (GL 3.3); NORMAL_VIEW colors by world normal, decoded from the
+// octahedral attribute or, with UNIT_SPHERE_NORMALS, taken from the position.
+// LIGHTING shades with the Frame block's lights without reading the normal
+// attribute: unit spheres use their position, faceted meshes the derivative
+// of the view-space position. SHADOW_CASTER draws depth only, through the
+// uLightViewProj of a shadow cascade.
+const char* meshBatchVertexShaderSource = R"SHADER(
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec2 aNormal;
+#ifdef MESH_BATCH_INDIRECT
+layout(location = 2) in uint aInstanceIndex;
+struct Instance {
+    vec4 modelRows[3];
+    vec4 boundingSphere;
+    vec3 color;
+    uint commandIndex;
+};
+layout(std430, binding = 0) readonly buffer Instances { Instance instances[]; };
+#else
+layout(location = 2) in vec4 aModelRow0;
+layout(location = 3) in vec4 aModelRow1;
+layout(location = 4) in vec4 aModelRow2;
+layout(location = 5) in vec3 aColor;
+#endif
+#ifdef SHADOW_CASTER
+uniform mat4 uLightViewProj;
+#endif
+out vec3 vColor;
+#ifdef LIGHTING
+out vec3 vViewPos;
+#ifdef UNIT_SPHERE_NORMALS
+out vec3 vNormal;
+#endif
+#endif
+void main()
+{
+#ifdef MESH_BATCH_INDIRECT
+    Instance inst = instances[aInstanceIndex];
+    vec4 row0 = inst.modelRows[0];
+    vec4 row1 = inst.modelRows[1];
+    vec4 row2 = inst.modelRows[2];
+    vColor = inst.color;
+#else
+    vec4 row0 = aModelRow0;
+    vec4 row1 = aModelRow1;
+    vec4 row2 = aModelRow2;
+    vColor = aColor;
+#endif
+    vec4 p = vec4(aPos, 1.0);
+    vec3 world = vec3(dot(row0, p), dot(row1, p), dot(row2, p));
+#ifdef NORMAL_VIEW
+#ifdef UNIT_SPHERE_NORMALS
+    vec3 n = aPos;
+#else
+    vec3 n = vec3(aNormal, 1.0 - abs(aNormal.x) - abs(aNormal.y));
+    float fold = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -fold : fold, n.y >= 0.0 ? -fold : fold);
+#endif
+    // Model matrices only carry uniform scale, so the rotation part maps normals.
+    vColor = normalize(vec3(dot(row0.xyz, n), dot(row1.xyz, n), dot(row2.xyz, n))) * 0.5 + 0.5;
+#endif
+#ifdef LIGHTING
+    vViewPos = (uView * vec4(world, 1.0)).xyz;
+#ifdef UNIT_SPHERE_NORMALS
+    vNormal = mat3(uView) * vec3(dot(row0.xyz, aPos), dot(row1.xyz, aPos), dot(row2.xyz, aPos));
+#endif
+#endif
+#ifdef SHADOW_CASTER
+    gl_Position = uLightViewProj * vec4(world, 1.0);
+#else
+    gl_Position = uViewProj * vec4(world, 1.0);
+#endif
+}
+)SHADER";
+
+const char* meshBatchFragmentShaderSource = R"SHADER(
+in vec3 vColor;
+#ifdef LIGHTING
+in vec3 vViewPos;
+#ifdef UNIT_SPHERE_NORMALS
+in vec3 vNormal;
+#endif
+#endif
+out vec4 FragColor;
+void main()
+{
+#ifdef LIGHTING
+#ifdef UNIT_SPHERE_NORMALS
+    vec3 n = normalize(vNormal);
+#else
+    // Faceted meshes: the face normal from screen-space derivatives of the
+    // position; it always faces the camera, whatever the winding.
+    vec3 n = normalize(cross(dFdx(vViewPos), dFdy(vViewPos)));
+#endif
+    FragColor = vec4(shadeLit(vColor, vViewPos, n, gl_FragCoord.xy), 1.0);
+#else
+    FragColor = vec4(vColor, 1.0);
+#endif
+}
+)SHADER";
+
+// Feature bits of the mesh batch variants, in table order.
+const uint32_t kMeshBatchFeatureIndirect = 1u << 0;
+const uint32_t kMeshBatchFeatureNormalView = 1u << 1;
+const uint32_t kMeshBatchFeatureUnitSphereNormals = 1u << 2;
+const uint32_t kMeshBatchFeatureLighting = 1u << 3;
+const uint32_t kMeshBatchFeatureShadowCaster = 1u << 4;
+const ShaderFeature meshBatchShaderFeatures[] = {
+    { "MESH_BATCH_INDIRECT", 430 },
+    { "NORMAL_VIEW", 330 },
+    { "UNIT_SPHERE_NORMALS", 330 },
+    { "LIGHTING", 330 },
+    { "SHADOW_CASTER", 330 }
+};
+
+// GPU frustum cull: every visible instance bumps its command's instance count
+// and writes its index into that command's slice of the visible list.
+const char* meshBatchCullComputeShaderSource = R"SHADER(
+#version 430 core
+layout(local_size_x = 64) in;
+struct Instance {
+    vec4 modelRows[3];
+    vec4 boundingSphere;
+    vec3 color;
+    uint commandIndex;
+};
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+layout(std430, binding = 0) readonly buffer Instances { Instance instances[]; };
+layout(std430, binding = 1) buffer Commands { DrawCommand commands[]; };
+layout(std430, binding = 2) writeonly buffer Visible { uint visible[]; };
+uniform vec4 uFrustumPlanes[6];
+uniform uint uInstanceCount;
+void main()
+{
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= uInstanceCount)
+        return;
+    vec4 sphere = instances[i].boundingSphere;
+    for (int p = 0; p < 6; ++p) {
+        if (dot(uFrustumPlanes[p].xyz, sphere.xyz) + uFrustumPlanes[p].w < -sphere.w)
+            return;
+    }
+    uint cmd = instances[i].commandIndex;
+    uint slot = atomicAdd(commands[cmd].instanceCount, 1u);
+    visible[commands[cmd].baseInstance + slot] = i;
+}
+)SHADER";
+
+// Sphere impostors: each instance is a quad placed in front of the sphere and
+// sized to cover its perspective silhouette. The fragment shader intersects the
+// view ray with the exact sphere and writes the hit depth; LIGHTING shades with
+// the exact sphere normal.
+const char* sphereImpostorVertexShaderSource = R"SHADER(
+layout(location = 0) in vec2 aCorner;
+layout(location = 1) in vec4 aCenterRadius;
+layout(location = 2) in vec3 aColor;
+uniform mat4 uProjection;
+out vec3 vViewPos;
+flat out vec3 vCenter;
+flat out float vRadius;
+flat out vec3 vColor;
+void main()
+{
+    vec3 center = (uView * vec4(aCenterRadius.xyz, 1.0)).xyz;
+    float radius = aCenterRadius.w;
+    float dist = max(length(center), radius * 1.001);
+    vec3 forward = center / dist;
+    vec3 helper = abs(forward.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+    vec3 right = normalize(cross(forward, helper));
+    vec3 up = cross(right, forward);
+    // Plane through the sphere's nearest point, grown to the silhouette cone.
+    float planeDist = dist - radius;
+    float halfSize = planeDist * radius / sqrt(dist * dist - radius * radius);
+    vViewPos = forward * planeDist + (right * aCorner.x + up * aCorner.y) * halfSize;
+    vCenter = center;
+    vRadius = radius;
+    vColor = aColor;
+    gl_Position = uProjection * vec4(vViewPos, 1.0);
+}
+)SHADER";
+
+const char* sphereImpostorFragmentShaderSource = R"SHADER(
+in vec3 vViewPos;
+flat in vec3 vCenter;
+flat in float vRadius;
+flat in vec3 vColor;
+uniform mat4 uProjection;
+out vec4 FragColor;
+void main()
+{
+    vec3 rayDir = normalize(vViewPos);
+    float b = dot(rayDir, vCenter);
+    float h = b * b - dot(vCenter, vCenter) + vRadius * vRadius;
+    if (h < 0.0)
+        discard;
+    vec3 hit = rayDir * (b - sqrt(h));
+    vec4 clip = uProjection * vec4(hit, 1.0);
+    gl_FragDepth = 0.5 * (clip.z / clip.w) + 0.5;
+#ifdef LIGHTING
+    FragColor = vec4(shadeLit(vColor, hit, (hit - vCenter) / vRadius, gl_FragCoord.xy), 1.0);
+#else
+    FragColor = vec4(vColor, 1.0);
+#endif
+}
+)SHADER";
+
+// Sphere impostor variant features.
+const uint32_t kSphereImpostorFeatureLighting = 1u << 0;
+const ShaderFeature sphereImpostorShaderFeatures[] = {
+    { "LIGHTING", 330 }
+};
+
+// Physics debug lines: world-space positions with a per-vertex color.
+const char* debugLineVertexShaderSource = R"SHADER(
 #version 330 core
 layout(location = 0) in vec3 aPos;
-uniform mat4 uMVP;
+layout(location = 1) in vec4 aColor;
+uniform mat4 uViewProj;
+out vec3 vColor;
 void main()
 {
-    gl_Position = uMVP * vec4(aPos, 1.0);
+    vColor = aColor.rgb;
+    gl_Position = uViewProj * vec4(aPos, 1.0);
 }
 )SHADER";
 
-const char* fragmentShaderSource = R"SHADER(
+const char* debugLineFragmentShaderSource = R"SHADER(
 #version 330 core
+in vec3 vColor;
 out vec4 FragColor;
-uniform vec3 uColor;
 void main()
 {
-    FragColor = vec4(uColor, 1.0);
+    FragColor = vec4(vColor, 1.0);
 }
 )SHADER";
 
@@ -61,15 +454,41 @@ float lastY = windowHeight / 2.0f;
 // true  = GUI/Interaction mode (cursor visible)
 bool guiInputMode = false; // Change to 'true' for default GUI mode.
 
-// Shader program ID
-GLuint shaderProgram = 0;
+// Shader program IDs
+ShaderVariantSet groundGridShaders;
+GLuint meshBatchCullProgram = 0;
+ShaderVariantSet meshBatchShaders;
+
+// Per-frame uniforms shared by every shader variant through the Frame block.
+struct FrameUniforms {
+    glm::mat4 viewProj;
+    glm::mat4 view;
+    glm::vec4 lightDirection;   // view space
+    glm::vec4 lightColor;
+    glm::vec4 ambientColor;
+    glm::vec4 clusterScale;
+    glm::ivec4 clusterGrid;
+    glm::mat4 shadowMatrices[kShadowCascadeCount];
+    glm::vec4 shadowSplits;
+    glm::vec4 shadowTexelSizes;
+};
+GLuint frameUniformBuffer = 0;
+GLuint debugLineProgram = 0;
+ShaderVariantSet sphereImpostorShaders;
 
 // Bullet Physics globals
 btDiscreteDynamicsWorld* dynamicsWorld = nullptr;
-btRigidBody* pickedBody = nullptr;
+Entity pickedEntity;    // valid while pickConstraint exists
 btPoint2PointConstraint* pickConstraint = nullptr;
 
+// Physics debug drawing: every debug line for the frame goes into one batch.
+BatchedDebugDraw debugDrawer;
+int debugDrawMaxLines = 200000;
+
 // Matrices for rendering
+const float kCameraFovDegrees = 45.0f;
+const float kCameraNear = 0.1f;
+const float kCameraFar = 1000.0f;
 glm::mat4 projectionMatrix;
 glm::mat4 viewMatrix;
 
@@ -77,47 +496,9 @@ glm::mat4 viewMatrix;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-// --- Utility Functions ---
-
-GLuint compileShader(GLenum type, const char* source) {
-    GLuint shader = glCreateShader(type);
-    if (!shader) {
-        std::cerr << "Error creating shader!" << std::endl;
-        exit(EXIT_FAILURE);
-    }
-    glShaderSource(shader, 1, &source, nullptr);
-    glCompileShader(shader);
-    GLint status;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-    if (status != GL_TRUE) {
-        char buffer[512];
-        glGetShaderInfoLog(shader, 512, nullptr, buffer);
-        std::cerr << "Shader Compile Error: " << buffer << std::endl;
-    }
-    return shader;
-}
-
-GLuint createShaderProgram(const char* vertexSrc, const char* fragmentSrc) {
-    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSrc);
-    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSrc);
-    GLuint program = glCreateProgram();
-    glAttachShader(program, vertexShader);
-    glAttachShader(program, fragmentShader);
-    glLinkProgram(program);
-    GLint status;
-    glGetProgramiv(program, GL_LINK_STATUS, &status);
-    if (status != GL_TRUE) {
-        char buffer[512];
-        glGetProgramInfoLog(program, 512, nullptr, buffer);
-        std::cerr << "Program Linking Error: " << buffer << std::endl;
-    }
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-    return program;
-}
-
 // --- Cube Mesh Data ---
-float cubeVertices[] = {
+// Source triangle list; welded into an indexed mesh when added to the arena.
+const float cubeVertices[] = {
     // Back face
    -0.5f, -0.5f, -0.5f,    0.5f, -0.5f, -0.5f,    0.5f,  0.5f, -0.5f,
     0.5f,  0.5f, -0.5f,   -0.5f,  0.5f, -0.5f,   -0.5f, -0.5f, -0.5f,
@@ -138,96 +519,150 @@ float cubeVertices[] = {
     0.5f,  0.5f,  0.5f,   -0.5f,  0.5f,  0.5f,   -0.5f,  0.5f, -0.5f
 };
 
-GLuint cubeVAO, cubeVBO;
-
-void setupCubeMesh() {
-    glGenVertexArrays(1, &cubeVAO);
-    glGenBuffers(1, &cubeVBO);
-    glBindVertexArray(cubeVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), reinterpret_cast<void*>(0));
-    glEnableVertexAttribArray(0);
-    glBindVertexArray(0);
-}
-
-// --- UV Sphere Mesh Data ---
-struct Mesh {
-    GLuint VAO;
-    GLuint VBO;
-    GLuint EBO;
-    size_t indexCount;
+// --- Shared Mesh Arena ---
+// Every static mesh (cube and sphere LODs) lives in one vertex/index buffer pair.
+MeshArena meshArena;
+
+MeshRange cubeMesh;
+
+// --- Sphere LOD Chain ---
+SphereLodChain sphereLodChain;
+float sphereLodBias = 1.0f;
+
+// --- Mesh Batch ---
+// Dynamic boxes and LOD spheres are drawn through one batch: one command per
+// arena mesh, submitted instanced (GL 3.3) or with multi-draw indirect (GL 4.3).
+MeshBatch meshBatch;
+uint32_t cubeBatchCommand = 0;
+uint32_t sphereLodBatchCommands[kSphereLodCount];
+MeshBatchPath meshBatchPath = MeshBatchPath::Instanced;
+bool gpuFrustumCull = true;
+bool meshNormalView = false; // debug shading variant: world normals as color
+
+// --- Lighting ---
+// One directional light plus ambient, applied by the LIGHTING shader variants.
+bool sceneLighting = true;
+glm::vec3 lightDirection(-0.4f, -1.0f, -0.3f);
+
+// --- Point Lights ---
+// Clustered point lights, carried by entities with a light component; a light
+// on a body follows the body's interpolated transform every frame.
+std::vector<PointLight> pointLights;   // world-space lights of the frame
+LightClusterGrid lightClusters;
+bool pointLightsEnabled = true;
+
+// --- Shadows ---
+// Cascaded shadow maps for the directional light. Casters go through their own
+// mesh batch (cube and one sphere LOD), culled against each cascade's frustum.
+ShadowCascades shadowCascades;
+MeshBatch shadowBatch;
+uint32_t shadowCubeCommand = 0;
+uint32_t shadowSphereCommand = 0;
+bool shadowsEnabled = true;
+float shadowDistance = 100.0f;
+size_t shadowCasterCounts[kShadowCascadeCount] = {};
+bool shadowCacheRendered = false;   // this frame
+
+// --- Frame Profiler ---
+// CPU time per phase, plus GPU time for the render passes.
+FrameProfiler frameProfiler;
+int profilePhysics = 0;
+int profileGround = 0;
+int profileBodies = 0;
+int profileDebugDraw = 0;
+int profileImGui = 0;
+int profileLightClusters = 0;
+int profileShadows = 0;
+bool showPerformanceWindow = false;
+
+// --- Frame Budget Governor ---
+// Sheds physics and render quality while frames run over budget (windowed
+// runs only; headless runs keep every setting for reproducible output).
+FrameGovernor frameGovernor;
+
+// --- Ground Grid ---
+// Drawn everywhere the infinite physics plane is visible.
+GroundGridRenderer groundGridRenderer;
+float groundGridCellSize = 1.0f;
+float groundGridFadeDistance = 150.0f;
+
+// --- Frame Capture ---
+FrameCapture frameCapture;
+FrameCaptureSettings frameCaptureSettings;
+
+// --- Sphere Impostors ---
+SphereImpostorRenderer sphereImpostorRenderer;
+std::vector<SphereInstance> sphereImpostorInstances;
+
+// How dynamic spheres are drawn; selectable from the Options menu.
+enum class SphereRenderMode {
+    MeshLod,
+    Impostor
 };
+SphereRenderMode sphereRenderMode = SphereRenderMode::MeshLod;
 
-Mesh createSphereMesh(unsigned int sectorCount = 20, unsigned int stackCount = 20, float radius = 0.5f) {
-    std::vector<float> vertices;
-    std::vector<unsigned int> indices;
-    float x, y, z, xy;
-    float sectorStep = 2 * glm::pi<float>() / sectorCount;
-    float stackStep = glm::pi<float>() / stackCount;
-    for (unsigned int i = 0; i <= stackCount; ++i) {
-        float stackAngle = glm::pi<float>() / 2 - i * stackStep;
-        xy = radius * cosf(stackAngle);
-        z = radius * sinf(stackAngle);
-        for (unsigned int j = 0; j <= sectorCount; ++j) {
-            float sectorAngle = j * sectorStep;
-            x = xy * cosf(sectorAngle);
-            y = xy * sinf(sectorAngle);
-            vertices.push_back(x);
-            vertices.push_back(y);
-            vertices.push_back(z);
-        }
-    }
-    for (unsigned int i = 0; i < stackCount; ++i) {
-        unsigned int k1 = i * (sectorCount + 1);
-        unsigned int k2 = k1 + sectorCount + 1;
-        for (unsigned int j = 0; j < sectorCount; ++j, ++k1, ++k2) {
-            if (i != 0) {
-                indices.push_back(k1);
-                indices.push_back(k2);
-                indices.push_back(k1 + 1);
-            }
-            if (i != (stackCount - 1)) {
-                indices.push_back(k1 + 1);
-                indices.push_back(k2);
-                indices.push_back(k2 + 1);
-            }
-        }
-    }
-    Mesh sphere;
-    sphere.indexCount = indices.size();
-    glGenVertexArrays(1, &sphere.VAO);
-    glGenBuffers(1, &sphere.VBO);
-    glGenBuffers(1, &sphere.EBO);
-    glBindVertexArray(sphere.VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, sphere.VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphere.EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), reinterpret_cast<void*>(0));
-    glEnableVertexAttribArray(0);
-    glBindVertexArray(0);
-    return sphere;
-}
+// --- Job System ---
+// One thread pool for Bullet's multithreaded world, the entity systems,
+// shadow culling and frame capture encoding.
+JobSystem jobSystem;
 
-Mesh sphereMesh;
+// --- Scene Entities ---
+// Every dynamic object is an entity. How it is drawn is data on the entity
+// (render mesh, color), so a new kind of object needs a mesh table entry rather
+// than another branch in the render loop.
+EntityWorld sceneEntities;
+std::vector<EntityChunk> entityChunks;   // scratch for the systems
+std::vector<Entity> doomedEntities;      // scratch for batch destruction
+float spawnLifetime = 0.0f;              // seconds; 0 keeps spawned objects
+float spawnBoxHalfExtent = 1.0f;
+float spawnSphereRadius = 0.5f;
+
+// What a RenderMesh's mesh index refers to.
+struct SceneMesh {
+    uint32_t batchCommand;    // in meshBatch
+    uint32_t shadowCommand;   // in shadowBatch
+    uint32_t material;        // for the sort key
+    bool sphereLod;           // drawn from the sphere LOD chain, or as an impostor
+};
+const uint32_t kSceneMeshBox = 0;
+const uint32_t kSceneMeshSphere = 1;
+SceneMesh sceneMeshes[2];
 
 // --- Bullet Physics Setup ---
+PhysicsPoolSettings physicsPoolSettings;
+btDefaultCollisionConfiguration* collisionConfiguration = nullptr;
+PooledCollisionDispatcher* collisionDispatcher = nullptr;
+
+glm::vec3 worldGravity(0.0f, -9.81f, 0.0f);
+
 btDiscreteDynamicsWorld* initPhysics() {
-    auto* collisionConfiguration = new btDefaultCollisionConfiguration();
-    auto* dispatcher = new btCollisionDispatcher(collisionConfiguration);
+    collisionConfiguration = new btDefaultCollisionConfiguration(makeCollisionConstructionInfo(physicsPoolSettings));
+    // Narrowphase, islands and constraint solving run on the job system. The
+    // solver pool has one solver per thread Bullet may run on.
+    auto* dispatcher = new PooledCollisionDispatcher(collisionConfiguration, 40);
+    if (physicsPoolSettings.prewarm)
+        prewarmPhysicsPools(*collisionConfiguration, *dispatcher);
+    collisionDispatcher = dispatcher;
     auto* overlappingPairCache = new btDbvtBroadphase();
-    auto* solver = new btSequentialImpulseConstraintSolver;
-    btDiscreteDynamicsWorld* world = new btDiscreteDynamicsWorld(dispatcher, overlappingPairCache, solver, collisionConfiguration);
-    world->setGravity(btVector3(0, -9.81f, 0));
+    auto* solverPool = new btConstraintSolverPoolMt(jobSystem.getNumThreads());
+    auto* solver = new btSequentialImpulseConstraintSolverMt;
+    btDiscreteDynamicsWorld* world = new btDiscreteDynamicsWorldMt(dispatcher, overlappingPairCache, solverPool, solver,
+                                                                   collisionConfiguration);
+    world->setGravity(btVector3(worldGravity.x, worldGravity.y, worldGravity.z));
     return world;
 }
 
+// Every body's shape comes from the registry, so bodies of the same size share
+// one shape and its inertia.
+ShapeRegistry shapeRegistry;
+
+// The body keeps the shape reference the caller acquired; destroying the body
+// releases it.
 btRigidBody* createRigidBody(btCollisionShape* shape, float mass, const btTransform& transform) {
     bool isDynamic = (mass != 0.f);
     btVector3 localInertia(0, 0, 0);
     if (isDynamic)
-        shape->calculateLocalInertia(mass, localInertia);
+        localInertia = shapeLocalInertia(shapeRegistry, shape, mass);
     auto* motionState = new btDefaultMotionState(transform);
     btRigidBody::btRigidBodyConstructionInfo rbInfo(mass, motionState, shape, localInertia);
     btRigidBody* body = new btRigidBody(rbInfo);
@@ -235,6 +670,183 @@ btRigidBody* createRigidBody(btCollisionShape* shape, float mass, const btTransf
     return body;
 }
 
+// Creates a dynamic body at position and the entity that draws it; the entity
+// also gets a lifetime when lifetime > 0 and a light when one is given.
+Entity spawnBodyEntity(btCollisionShape* shape, const RenderMesh& mesh, const glm::vec3& color,
+                       const glm::vec3& position, float lifetime, const LightEmitter* light = nullptr) {
+    btTransform transform;
+    transform.setIdentity();
+    transform.setOrigin(btVector3(position.x, position.y, position.z));
+    btRigidBody* body = createRigidBody(shape, 1.0f, transform);
+    ComponentMask components = kComponentTransform | kComponentBody | kComponentRenderMesh | kComponentColor;
+    if (lifetime > 0.0f)
+        components |= kComponentLifetime;
+    if (light)
+        components |= kComponentLight;
+    Entity entity = createEntity(sceneEntities, components);
+    EntityRef ref = lookupEntity(sceneEntities, entity);
+    Archetype& archetype = *ref.archetype;
+    btScalar m[16];
+    transform.getOpenGLMatrix(m);
+    archetype.transforms[ref.row] = glm::make_mat4(m);
+    archetype.bodies[ref.row] = body;
+    archetype.meshes[ref.row] = mesh;
+    archetype.colors[ref.row] = color;
+    if (lifetime > 0.0f)
+        archetype.lifetimes[ref.row] = lifetime;
+    if (light)
+        archetype.lights[ref.row] = *light;
+    // Lets picking map a ray hit back to the entity.
+    body->setUserIndex(static_cast<int>(entity.index));
+    body->setUserIndex2(static_cast<int>(entity.generation));
+    return entity;
+}
+
+// Boxes draw the unit cube scaled to the box, spheres the unit sphere scaled
+// to the radius. A box collides at its full half extents: btBoxShape stores
+// them less the margin, so the mesh is sized with the margin added back.
+Entity spawnBox(const btVector3& halfExtents, const glm::vec3& color, const glm::vec3& position, float lifetime) {
+    btBoxShape* shape = acquireBoxShape(shapeRegistry, halfExtents);
+    RenderMesh mesh;
+    mesh.mesh = kSceneMeshBox;
+    const btVector3 extents = shape->getHalfExtentsWithMargin();
+    mesh.scale = 2.0f * glm::vec3(extents.x(), extents.y(), extents.z());
+    mesh.boundingRadius = extents.length();
+    return spawnBodyEntity(shape, mesh, color, position, lifetime);
+}
+
+Entity spawnSphere(btScalar radius, const glm::vec3& color, const glm::vec3& position, float lifetime,
+                   const LightEmitter* light = nullptr) {
+    btSphereShape* shape = acquireSphereShape(shapeRegistry, radius);
+    RenderMesh mesh;
+    mesh.mesh = kSceneMeshSphere;
+    mesh.scale = glm::vec3(shape->getRadius());
+    mesh.boundingRadius = shape->getRadius();
+    return spawnBodyEntity(shape, mesh, color, position, lifetime, light);
+}
+
+// Destroys an entity along with its body, dropping the pick constraint if it
+// holds that body.
+void destroySceneEntity(Entity entity) {
+    EntityRef ref = lookupEntity(sceneEntities, entity);
+    if (!ref.archetype)
+        return;
+    if (ref.archetype->components & kComponentBody) {
+        btRigidBody* body = ref.archetype->bodies[ref.row];
+        if (pickConstraint && &pickConstraint->getRigidBodyA() == body) {
+            dynamicsWorld->removeConstraint(pickConstraint);
+            delete pickConstraint;
+            pickConstraint = nullptr;
+        }
+        dynamicsWorld->removeRigidBody(body);
+        btCollisionShape* shape = body->getCollisionShape();
+        delete body->getMotionState();
+        delete body;
+        releaseShape(shapeRegistry, shape);
+    }
+    destroyEntity(sceneEntities, entity);
+}
+
+// Destroys every entity that has all of the given components.
+void destroySceneEntities(ComponentMask required) {
+    collectEntityChunks(sceneEntities, required, entityChunks);
+    doomedEntities.clear();
+    for (const EntityChunk& chunk : entityChunks)
+        doomedEntities.insert(doomedEntities.end(), chunk.entities, chunk.entities + chunk.count);
+    for (Entity entity : doomedEntities)
+        destroySceneEntity(entity);
+}
+
+// --- Entity Systems ---
+// Counts lifetimes down and destroys the entities that run out.
+void expireEntities(float elapsed) {
+    collectEntityChunks(sceneEntities, kComponentLifetime, entityChunks);
+    doomedEntities.clear();
+    for (const EntityChunk& chunk : entityChunks) {
+        for (uint32_t i = 0; i < chunk.count; ++i) {
+            chunk.lifetimes[i] -= elapsed;
+            if (chunk.lifetimes[i] <= 0.0f)
+                doomedEntities.push_back(chunk.entities[i]);
+        }
+    }
+    for (Entity entity : doomedEntities)
+        destroySceneEntity(entity);
+}
+
+// Copies every body's interpolated transform into its entity.
+void syncBodyTransforms() {
+    collectEntityChunks(sceneEntities, kComponentTransform | kComponentBody, entityChunks);
+    parallelForEntityChunks(jobSystem, entityChunks, [](const EntityChunk& chunk) {
+        for (uint32_t i = 0; i < chunk.count; ++i) {
+            btTransform trans;
+            chunk.bodies[i]->getMotionState()->getWorldTransform(trans);
+            btScalar m[16];
+            trans.getOpenGLMatrix(m);
+            chunk.transforms[i] = glm::make_mat4(m);
+        }
+    });
+}
+
+float simulationStep = 1.0f / 60.0f;
+int physicsSubsteps = 1;        // per simulationStep
+int solverIterations = 10;      // Bullet's default
+const int kMinSolverIterations = 4;
+uint64_t physicsStepAllocations = 0;   // Bullet allocations during the last step
+uint64_t physicsStepPoolOverflows = 0; // manifolds and algorithms that missed their pools
+
+// Solver iterations after the governor: half of them, down to a floor, while
+// that step is shed.
+int governedSolverIterations() {
+    if (!governorShed(frameGovernor, GovernorStep::SolverIterations))
+        return solverIterations;
+    return std::min(solverIterations, std::max(solverIterations / 2, kMinSolverIterations));
+}
+
+// One fixed physics step, then the entity updates that follow the bodies.
+void stepScene() {
+    beginProfilerPhase(frameProfiler, profilePhysics);
+    const uint64_t allocations = bulletAllocationCount();
+    const uint64_t overflows = getPhysicsPoolStats(*collisionConfiguration, *collisionDispatcher).overflows;
+    const int substeps = governorShed(frameGovernor, GovernorStep::PhysicsSubsteps) ? 1 : physicsSubsteps;
+    dynamicsWorld->getSolverInfo().m_numIterations = governedSolverIterations();
+    dynamicsWorld->stepSimulation(simulationStep, substeps, simulationStep / substeps);
+    physicsStepAllocations = bulletAllocationCount() - allocations;
+    physicsStepPoolOverflows = getPhysicsPoolStats(*collisionConfiguration, *collisionDispatcher).overflows - overflows;
+    expireEntities(simulationStep);
+    syncBodyTransforms();
+    endProfilerPhase(frameProfiler, profilePhysics);
+}
+
+// Steps the governor with this frame's costs: physics and ImGui from their
+// profiler phases, render as the rest of the frame's CPU work, GPU as the sum
+// of the timed passes. Only steps that would change something can be shed.
+void governFrame() {
+    if (!frameGovernor.settings.enabled) {
+        resetFrameGovernor(frameGovernor, "governor off");
+        return;
+    }
+    FrameCosts costs;
+    costs.physics = frameProfiler.phases[profilePhysics].cpuMilliseconds;
+    costs.ui = frameProfiler.phases[profileImGui].cpuMilliseconds;
+    costs.render = std::max(frameProfiler.workMilliseconds - costs.physics - costs.ui, 0.0);
+    for (size_t i = 0; i < frameProfiler.phases.size(); ++i) {
+        if (frameProfiler.phases[i].gpuTimed && profilerPhaseActive(frameProfiler, static_cast<int>(i)))
+            costs.gpu += frameProfiler.phases[i].gpuMilliseconds;
+    }
+    uint32_t available = 0;
+    if (physicsSubsteps > 1)
+        available |= governorStepBit(GovernorStep::PhysicsSubsteps);
+    if (std::max(solverIterations / 2, kMinSolverIterations) < solverIterations)
+        available |= governorStepBit(GovernorStep::SolverIterations);
+    if (sphereRenderMode == SphereRenderMode::MeshLod)
+        available |= governorStepBit(GovernorStep::SphereLod);
+    if (debugDrawer.getDebugMode() != btIDebugDraw::DBG_NoDebug)
+        available |= governorStepBit(GovernorStep::DebugDraw);
+    if (sceneLighting && shadowsEnabled && shadowCascades.size > 0)
+        available |= governorStepBit(GovernorStep::Shadows);
+    updateFrameGovernor(frameGovernor, costs, available);
+}
+
 // --- screenPosToWorldRay ---
 // Convert screen (mouse) coordinates into a world-space ray direction.
 glm::vec3 screenPosToWorldRay(double mouseX, double mouseY) {
@@ -248,91 +860,143 @@ glm::vec3 screenPosToWorldRay(double mouseX, double mouseY) {
     return glm::normalize(glm::vec3(rayWorld));
 }
 
+// --- Input Events ---
+// The GLFW callbacks below only queue what happened. applyInputEvents acts on
+// it on the simulation side, at the start of the next step.
+InputQueue inputQueue;
+std::vector<InputEvent> inputEvents;   // scratch for draining
+
+void queueInputEvent(InputEventType type, double x, double y, int code, int action, int mods) {
+    InputEvent event;
+    event.type = type;
+    event.time = glfwGetTime();
+    event.x = x;
+    event.y = y;
+    event.code = code;
+    event.action = action;
+    event.mods = mods;
+    pushInputEvent(inputQueue, event);
+}
+
 // --- Combined Cursor Position Callback ---
-// When in FPS mode, update camera look.
-// When in GUI mode, update picking (if any).
 void combinedCursorPosCallback(GLFWwindow* window, double xpos, double ypos) {
-    if (!guiInputMode) {
-        // FPS mode: update camera look.
-        if (firstMouse) {
-            lastX = static_cast<float>(xpos);
-            lastY = static_cast<float>(ypos);
-            firstMouse = false;
-        }
-        float xoffset = static_cast<float>(xpos) - lastX;
-        float yoffset = lastY - static_cast<float>(ypos);
+    queueInputEvent(InputEventType::CursorMove, xpos, ypos, 0, 0, 0);
+}
+
+// --- Mouse Button Callback ---
+void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
+    double mouseX, mouseY;
+    glfwGetCursorPos(window, &mouseX, &mouseY);
+    queueInputEvent(InputEventType::MouseButton, mouseX, mouseY, button, action, mods);
+}
+
+// --- Key Callback ---
+void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    queueInputEvent(InputEventType::Key, 0.0, 0.0, key, action, mods);
+}
+
+// FPS mode: turns the camera by the cursor's motion since the last move.
+void turnCamera(double xpos, double ypos) {
+    if (firstMouse) {
         lastX = static_cast<float>(xpos);
         lastY = static_cast<float>(ypos);
-        float sensitivity = 0.1f;
-        xoffset *= sensitivity;
-        yoffset *= sensitivity;
-        yaw   += xoffset;
-        pitch += yoffset;
-        if (pitch > 89.0f)
-            pitch = 89.0f;
-        if (pitch < -89.0f)
-            pitch = -89.0f;
-        glm::vec3 front;
-        front.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
-        front.y = sin(glm::radians(pitch));
-        front.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
-        cameraFront = glm::normalize(front);
-    } else {
-        // GUI mode: update picking constraint pivot if exists.
-        if (pickConstraint) {
-            glm::vec3 rayDir = screenPosToWorldRay(xpos, ypos);
-            glm::vec3 newPivot = cameraPos + rayDir * 10.0f;
-            pickConstraint->setPivotB(btVector3(newPivot.x, newPivot.y, newPivot.z));
+        firstMouse = false;
+    }
+    float xoffset = static_cast<float>(xpos) - lastX;
+    float yoffset = lastY - static_cast<float>(ypos);
+    lastX = static_cast<float>(xpos);
+    lastY = static_cast<float>(ypos);
+    float sensitivity = 0.1f;
+    xoffset *= sensitivity;
+    yoffset *= sensitivity;
+    yaw   += xoffset;
+    pitch += yoffset;
+    if (pitch > 89.0f)
+        pitch = 89.0f;
+    if (pitch < -89.0f)
+        pitch = -89.0f;
+    glm::vec3 front;
+    front.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
+    front.y = sin(glm::radians(pitch));
+    front.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
+    cameraFront = glm::normalize(front);
+}
+
+// GUI mode: picks the dynamic body under the cursor and attaches the pick
+// constraint to it.
+void beginPick(double mouseX, double mouseY) {
+    glm::vec3 rayDir = screenPosToWorldRay(mouseX, mouseY);
+    glm::vec3 rayFrom = cameraPos;
+    glm::vec3 rayTo = cameraPos + rayDir * 1000.0f;
+    btVector3 btRayFrom(rayFrom.x, rayFrom.y, rayFrom.z);
+    btVector3 btRayTo(rayTo.x, rayTo.y, rayTo.z);
+    btCollisionWorld::ClosestRayResultCallback rayCallback(btRayFrom, btRayTo);
+    dynamicsWorld->rayTest(btRayFrom, btRayTo, rayCallback);
+    if (rayCallback.hasHit()) {
+        btRigidBody* body = const_cast<btRigidBody*>(btRigidBody::upcast(rayCallback.m_collisionObject));
+        if (body && !(body->isStaticObject() || body->isKinematicObject())) {
+            pickedEntity.index = static_cast<uint32_t>(body->getUserIndex());
+            pickedEntity.generation = static_cast<uint32_t>(body->getUserIndex2());
+            body->setActivationState(DISABLE_DEACTIVATION);
+            btVector3 pickPos = rayCallback.m_hitPointWorld;
+            btVector3 localPivot = body->getCenterOfMassTransform().inverse() * pickPos;
+            pickConstraint = new btPoint2PointConstraint(*body, localPivot);
+            dynamicsWorld->addConstraint(pickConstraint, true);
         }
     }
 }
 
-// --- Mouse Button Callback ---
-// In GUI mode, process object picking.
-void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
-    if (!guiInputMode)
-        return;
-    if (button == GLFW_MOUSE_BUTTON_LEFT) {
-        if (action == GLFW_PRESS) {
-            double mouseX, mouseY;
-            glfwGetCursorPos(window, &mouseX, &mouseY);
-            glm::vec3 rayDir = screenPosToWorldRay(mouseX, mouseY);
-            glm::vec3 rayFrom = cameraPos;
-            glm::vec3 rayTo = cameraPos + rayDir * 1000.0f;
-            btVector3 btRayFrom(rayFrom.x, rayFrom.y, rayFrom.z);
-            btVector3 btRayTo(rayTo.x, rayTo.y, rayTo.z);
-            btCollisionWorld::ClosestRayResultCallback rayCallback(btRayFrom, btRayTo);
-            dynamicsWorld->rayTest(btRayFrom, btRayTo, rayCallback);
-            if (rayCallback.hasHit()) {
-                btRigidBody* body = const_cast<btRigidBody*>(btRigidBody::upcast(rayCallback.m_collisionObject));
-                if (body && !(body->isStaticObject() || body->isKinematicObject())) {
-                    pickedBody = body;
-                    pickedBody->setActivationState(DISABLE_DEACTIVATION);
-                    btVector3 pickPos = rayCallback.m_hitPointWorld;
-                    btVector3 localPivot = body->getCenterOfMassTransform().inverse() * pickPos;
-                    pickConstraint = new btPoint2PointConstraint(*body, localPivot);
-                    dynamicsWorld->addConstraint(pickConstraint, true);
-                }
-            }
-        } else if (action == GLFW_RELEASE) {
-            if (pickConstraint) {
-                dynamicsWorld->removeConstraint(pickConstraint);
-                delete pickConstraint;
-                pickConstraint = nullptr;
-                if (pickedBody) {
-                    pickedBody->forceActivationState(ACTIVE_TAG);
-                    pickedBody->setDeactivationTime(0.f);
-                    pickedBody = nullptr;
-                }
+void movePick(double mouseX, double mouseY) {
+    glm::vec3 rayDir = screenPosToWorldRay(mouseX, mouseY);
+    glm::vec3 newPivot = cameraPos + rayDir * 10.0f;
+    pickConstraint->setPivotB(btVector3(newPivot.x, newPivot.y, newPivot.z));
+}
+
+void endPick() {
+    dynamicsWorld->removeConstraint(pickConstraint);
+    delete pickConstraint;
+    pickConstraint = nullptr;
+    EntityRef picked = lookupEntity(sceneEntities, pickedEntity);
+    if (picked.archetype) {
+        btRigidBody* body = picked.archetype->bodies[picked.row];
+        body->forceActivationState(ACTIVE_TAG);
+        body->setDeactivationTime(0.f);
+    }
+}
+
+// Handles the input queued since the last step, in order. The cursor moves
+// of a step arrive as one event, so the pick pivot moves once per step.
+void applyInputEvents(GLFWwindow* window) {
+    drainInputEvents(inputQueue, inputEvents);
+    for (const InputEvent& event : inputEvents) {
+        if (event.type == InputEventType::CursorMove) {
+            // FPS mode turns the camera; GUI mode drags the picked body.
+            if (!guiInputMode)
+                turnCamera(event.x, event.y);
+            else if (pickConstraint)
+                movePick(event.x, event.y);
+        } else if (event.type == InputEventType::MouseButton) {
+            if (!guiInputMode || event.code != GLFW_MOUSE_BUTTON_LEFT)
+                continue;
+            if (event.action == GLFW_PRESS && !pickConstraint)
+                beginPick(event.x, event.y);
+            else if (event.action == GLFW_RELEASE && pickConstraint)
+                endPick();
+        } else if (event.type == InputEventType::Key) {
+            // ESC switches to GUI mode (shows the cursor).
+            if (event.code == GLFW_KEY_ESCAPE && event.action == GLFW_PRESS) {
+                guiInputMode = true;
+                glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
             }
         }
     }
 }
 
 // --- Input Handling for Camera Movement ---
-void processInput(GLFWwindow* window) {
+// Returns true when the camera moved.
+bool processInput(GLFWwindow* window) {
     if (guiInputMode)
-        return; // Don't move camera in GUI mode.
+        return false; // Don't move camera in GUI mode.
     float currentFrame = static_cast<float>(glfwGetTime());
     deltaTime = currentFrame - lastFrame;
     lastFrame = currentFrame;
@@ -345,140 +1009,768 @@ void processInput(GLFWwindow* window) {
         cameraPos -= glm::normalize(glm::cross(cameraFront, cameraUp)) * velocity;
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
         cameraPos += glm::normalize(glm::cross(cameraFront, cameraUp)) * velocity;
+    return glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS ||
+           glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS;
 }
 
-// --- Key Callback ---
-// Pressing ESC toggles to GUI mode (shows the cursor).
-void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
-    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
-        guiInputMode = true;
-        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
-    }
-}
+// --- Idle Mode ---
+// Once the scene is asleep and nothing has been touched for a few frames, the
+// loop stops stepping and rendering and blocks in glfwWaitEventsTimeout until
+// an event arrives.
+bool idleModeEnabled = true;
+const int kIdleWakeFrames = 3;          // frames kept after activity, so the GUI settles
+const double kIdleWaitSeconds = 0.5;    // longest single wait
+int idleCountdown = kIdleWakeFrames;
+double idleWindowStart = 0.0;
+double idleWindowSeconds = 0.0;
+float idlePercent = 0.0f;               // of the last full second
 
-// --- Rendering Helper Functions ---
-void drawCube(const glm::mat4& model, const glm::vec3& color) {
-    glUseProgram(shaderProgram);
-    glm::mat4 mvp = projectionMatrix * viewMatrix * model;
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "uMVP"), 1, GL_FALSE, glm::value_ptr(mvp));
-    glUniform3fv(glGetUniformLocation(shaderProgram, "uColor"), 1, glm::value_ptr(color));
-    glBindVertexArray(cubeVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
+// True when nothing in the scene changes without input: every body sleeps
+// and no entity is counting down a lifetime.
+bool sceneAsleep() {
+    if (countEntities(sceneEntities, kComponentLifetime) > 0)
+        return false;
+    collectEntityChunks(sceneEntities, kComponentBody, entityChunks);
+    for (const EntityChunk& chunk : entityChunks) {
+        for (uint32_t i = 0; i < chunk.count; ++i) {
+            if (chunk.bodies[i]->isActive())
+                return false;
+        }
+    }
+    return true;
 }
 
-void drawSphere(const glm::mat4& model, const glm::vec3& color, const Mesh& mesh) {
-    glUseProgram(shaderProgram);
-    glm::mat4 mvp = projectionMatrix * viewMatrix * model;
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "uMVP"), 1, GL_FALSE, glm::value_ptr(mvp));
-    glUniform3fv(glGetUniformLocation(shaderProgram, "uColor"), 1, glm::value_ptr(color));
-    glBindVertexArray(mesh.VAO);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh.indexCount), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+// Adds time spent blocked and rolls the percentage over once a second.
+void recordIdleTime(double seconds) {
+    idleWindowSeconds += seconds;
+    const double now = glfwGetTime();
+    if (now - idleWindowStart >= 1.0) {
+        idlePercent = static_cast<float>(100.0 * idleWindowSeconds / (now - idleWindowStart));
+        idleWindowStart = now;
+        idleWindowSeconds = 0.0;
+    }
 }
 
 // --- GUI Variables ---
 bool showDemoWindow = false;
 bool addBox = false;
 bool addSphere = false;
+bool addLightEmitters = false;
 bool deleteObjects = false;
 
-// Global vectors for dynamic bodies and collision shapes.
-std::vector<btRigidBody*> globalDynamicBodies;
-std::vector<btCollisionShape*> collisionShapes;
+// --- Scene Rendering ---
+// Everything drawn in a frame goes through the render queue: objects are
+// pushed with a sort key, sorted, then submitted in runs of one shader so each
+// program, VAO and batch is bound once per frame.
+
+// Shader ids in sort keys; within a pass, lower ids draw first.
+const uint32_t kRenderShaderGround = 0;
+const uint32_t kRenderShaderMeshBatch = 1;
+const uint32_t kRenderShaderSphereImpostor = 2;
+const uint32_t kRenderShaderDebugLines = 3;
+
+// Material ids in sort keys, indexing materialColors.
+const uint32_t kMaterialGround = 0;
+const uint32_t kMaterialBox = 1;
+const uint32_t kMaterialSphere = 2;
+const glm::vec3 backgroundColor(0.1f, 0.1f, 0.15f);
+const glm::vec3 materialColors[] = {
+    glm::vec3(0.3f, 0.8f, 0.3f),
+    glm::vec3(0.8f, 0.3f, 0.3f),
+    glm::vec3(0.3f, 0.3f, 0.8f)
+};
+
+struct RenderObject {
+    glm::mat4 model;        // impostors only use the translation
+    float boundingRadius;
+    uint32_t shader;
+    uint32_t mesh;          // mesh batch command for kRenderShaderMeshBatch
+    uint32_t material;
+    glm::vec3 color;
+};
+
+RenderQueue renderQueue;
+FrameVector<RenderObject> renderObjects;   // in the frame arena
+size_t renderQueueRuns = 0;
+
+void queueRenderObject(RenderPass pass, const RenderObject& object, float viewDistance) {
+    pushRenderItem(renderQueue, makeSortKey(pass, object.shader, object.mesh, object.material, viewDistance / kCameraFar),
+                   static_cast<uint32_t>(renderObjects.size()));
+    renderObjects.push_back(object);
+}
+
+// Profiler phase covering a shader's runs.
+int profilePhaseForShader(uint32_t shader) {
+    if (shader == kRenderShaderGround)
+        return profileGround;
+    if (shader == kRenderShaderDebugLines)
+        return profileDebugDraw;
+    return profileBodies;
+}
+
+// Draws items [begin, end) of the sorted queue, which all share one shader.
+void submitRenderRun(uint32_t shader, size_t begin, size_t end, const glm::mat4& viewProj) {
+    const std::vector<RenderQueueItem>& items = renderQueue.items;
+    if (shader == kRenderShaderGround) {
+        GLuint program = getShaderVariant(groundGridShaders, sceneLighting ? kGroundGridFeatureLighting : 0);
+        glUseProgram(program);
+        glUniformMatrix4fv(glGetUniformLocation(program, "uInvViewProj"), 1, GL_FALSE,
+                           glm::value_ptr(glm::inverse(viewProj)));
+        glUniform3fv(glGetUniformLocation(program, "uCameraPos"), 1, glm::value_ptr(cameraPos));
+        glUniform3fv(glGetUniformLocation(program, "uGroundColor"), 1, glm::value_ptr(materialColors[kMaterialGround]));
+        glUniform3f(glGetUniformLocation(program, "uLineColor"), 0.15f, 0.45f, 0.15f);
+        glUniform3fv(glGetUniformLocation(program, "uBackgroundColor"), 1, glm::value_ptr(backgroundColor));
+        glUniform1f(glGetUniformLocation(program, "uCellSize"), groundGridCellSize);
+        glUniform1f(glGetUniformLocation(program, "uFadeDistance"), groundGridFadeDistance);
+        drawGroundGrid(groundGridRenderer);
+    } else if (shader == kRenderShaderMeshBatch) {
+        // Items arrive grouped by mesh and front to back within each mesh, so
+        // every batch bucket is already in early-z friendly order.
+        for (size_t i = begin; i < end; ++i) {
+            const RenderObject& object = renderObjects[items[i].payload];
+            pushMeshBatchInstance(meshBatch, object.mesh, object.model, object.boundingRadius, object.color);
+        }
+        // Per-mesh features (sphere normals) only matter for lighting and the
+        // normal view, so mask them out otherwise to keep every bucket on one variant.
+        uint32_t batchFeatures = 0;
+        if (meshNormalView)
+            batchFeatures = kMeshBatchFeatureNormalView;
+        else if (sceneLighting)
+            batchFeatures = kMeshBatchFeatureLighting;
+        const uint32_t batchCommandFeatureMask = batchFeatures != 0 ? kMeshBatchFeatureUnitSphereNormals : 0;
+        if (meshBatchPath == MeshBatchPath::MultiDrawIndirect && meshBatchSupportsIndirect()) {
+            drawMeshBatchIndirect(meshBatch, meshBatchShaders, batchFeatures | kMeshBatchFeatureIndirect,
+                                  batchCommandFeatureMask, gpuFrustumCull ? meshBatchCullProgram : 0,
+                                  extractFrustum(viewProj));
+        } else {
+            drawMeshBatchInstanced(meshBatch, meshBatchShaders, batchFeatures, batchCommandFeatureMask);
+        }
+    } else if (shader == kRenderShaderSphereImpostor) {
+        sphereImpostorInstances.clear();
+        for (size_t i = begin; i < end; ++i) {
+            const RenderObject& object = renderObjects[items[i].payload];
+            SphereInstance instance;
+            instance.centerRadius = glm::vec4(glm::vec3(object.model[3]), object.boundingRadius);
+            instance.color = object.color;
+            sphereImpostorInstances.push_back(instance);
+        }
+        GLuint program = getShaderVariant(sphereImpostorShaders, sceneLighting ? kSphereImpostorFeatureLighting : 0);
+        glUseProgram(program);
+        glUniformMatrix4fv(glGetUniformLocation(program, "uProjection"), 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+        drawSphereImpostors(sphereImpostorRenderer, sphereImpostorInstances);
+    } else if (shader == kRenderShaderDebugLines) {
+        // Physics debug view: Bullet appends into the line batch, drawn in one call.
+        debugDrawer.clearLines();
+        dynamicsWorld->debugDrawWorld();
+        glUseProgram(debugLineProgram);
+        glUniformMatrix4fv(glGetUniformLocation(debugLineProgram, "uViewProj"), 1, GL_FALSE, glm::value_ptr(viewProj));
+        debugDrawer.render();
+    }
+}
+
+// Gathers the frame's point lights from the light entities.
+void gatherPointLights() {
+    pointLights.clear();
+    if (!sceneLighting || !pointLightsEnabled)
+        return;
+    pointLights.resize(collectEntityChunks(sceneEntities, kComponentTransform | kComponentLight, entityChunks));
+    parallelForEntityChunks(jobSystem, entityChunks, [](const EntityChunk& chunk) {
+        for (uint32_t i = 0; i < chunk.count; ++i) {
+            const LightEmitter& emitter = chunk.lights[i];
+            PointLight& light = pointLights[chunk.first + i];
+            light.position = glm::vec3(chunk.transforms[i] * glm::vec4(emitter.offset, 1.0f));
+            light.radius = emitter.radius;
+            light.color = emitter.color;
+        }
+    });
+}
+
+struct ShadowCaster {
+    glm::mat4 model;
+    glm::vec3 center;
+    float radius;
+    uint32_t command;   // in shadowBatch
+    bool resting;       // asleep, so it belongs in the far cascade's cache
+    uint64_t id;        // entity generation and index
+    uint32_t cascades;  // bit i: inside cascade i's light frustum
+};
+FrameVector<ShadowCaster> shadowCasters;   // in the frame arena
+std::vector<EntityChunk> shadowCasterChunks;
+JobCounter shadowCastersCulled;
+std::vector<uint64_t> restingCasterIds;   // in the far cascade, sorted
+bool movingCastersInFar = false;
+
+// Caster selection for drawShadowCasters.
+const int kCastersMoving = 1;
+const int kCastersResting = 2;
+const int kCastersAll = kCastersMoving | kCastersResting;
+
+// Draws the selected casters that pass the cascade's light-frustum cull into
+// the bound shadow framebuffer. Returns how many were drawn.
+size_t drawShadowCasters(int cascadeIndex, int selection) {
+    const ShadowCascade& cascade = shadowCascades.cascades[cascadeIndex];
+    clearMeshBatch(shadowBatch);
+    size_t drawn = 0;
+    for (const ShadowCaster& caster : shadowCasters) {
+        if (!(selection & (caster.resting ? kCastersResting : kCastersMoving)) ||
+            !(caster.cascades & (1u << cascadeIndex)))
+            continue;
+        pushMeshBatchInstance(shadowBatch, caster.command, caster.model, caster.radius, glm::vec3(0.0f));
+        ++drawn;
+    }
+    if (drawn == 0)
+        return 0;
+    const bool indirect = meshBatchPath == MeshBatchPath::MultiDrawIndirect && meshBatchSupportsIndirect();
+    const uint32_t features = kMeshBatchFeatureShadowCaster | (indirect ? kMeshBatchFeatureIndirect : 0);
+    // Uniforms are program state, so setting it here carries into the batch draw.
+    GLuint program = getShaderVariant(meshBatchShaders, features);
+    glUseProgram(program);
+    glUniformMatrix4fv(glGetUniformLocation(program, "uLightViewProj"), 1, GL_FALSE, glm::value_ptr(cascade.viewProj));
+    if (indirect)
+        drawMeshBatchIndirect(shadowBatch, meshBatchShaders, features, 0, 0, cascade.frustum);
+    else
+        drawMeshBatchInstanced(shadowBatch, meshBatchShaders, features, 0);
+    return drawn;
+}
+
+// Fits the cascades, then queues one job per entity chunk that builds its
+// casters and culls them against every cascade, and after all of those a job
+// that lists the far cascade's resting casters. Counts them all on ready, which
+// must be waited on before renderShadowMaps.
+void queueShadowCasters(const glm::vec3& direction, JobCounter& ready) {
+    fitShadowCascades(shadowCascades, cameraPos, cameraFront, glm::radians(kCameraFovDegrees),
+                      static_cast<float>(windowWidth) / windowHeight, kCameraNear, shadowDistance, direction);
+    shadowCasters = FrameVector<ShadowCaster>(FrameAllocator<ShadowCaster>(threadFrameArena()));
+    shadowCasters.resize(
+        collectEntityChunks(sceneEntities, kComponentTransform | kComponentRenderMesh, shadowCasterChunks));
+    for (size_t c = 0; c < shadowCasterChunks.size(); ++c) {
+        jobSystem.run([c]() {
+            const EntityChunk& chunk = shadowCasterChunks[c];
+            for (uint32_t i = 0; i < chunk.count; ++i) {
+                const RenderMesh& mesh = chunk.meshes[i];
+                ShadowCaster& caster = shadowCasters[chunk.first + i];
+                caster.model = glm::scale(chunk.transforms[i], mesh.scale);
+                caster.center = glm::vec3(chunk.transforms[i][3]);
+                caster.radius = mesh.boundingRadius;
+                caster.command = sceneMeshes[mesh.mesh].shadowCommand;
+                // Entities without a body never move.
+                caster.resting = !chunk.bodies || !chunk.bodies[i]->isActive();
+                caster.id = static_cast<uint64_t>(chunk.entities[i].generation) << 32 | chunk.entities[i].index;
+                caster.cascades = 0;
+                for (int cascade = 0; cascade < kShadowCascadeCount; ++cascade) {
+                    if (sphereInFrustum(shadowCascades.cascades[cascade].frustum, caster.center, caster.radius))
+                        caster.cascades |= 1u << cascade;
+                }
+            }
+        }, &shadowCastersCulled);
+    }
+    jobSystem.runAfter(shadowCastersCulled, []() {
+        restingCasterIds.clear();
+        movingCastersInFar = false;
+        for (const ShadowCaster& caster : shadowCasters) {
+            if (!(caster.cascades & (1u << kShadowCachedCascade)))
+                continue;
+            if (caster.resting)
+                restingCasterIds.push_back(caster.id);
+            else
+                movingCastersInFar = true;
+        }
+        std::sort(restingCasterIds.begin(), restingCasterIds.end());
+    }, &ready);
+}
+
+// Renders the shadow cascades for this frame from the casters queued by
+// queueShadowCasters. The near cascades are redrawn with every caster; the far
+// cascade's cache holds the resting (sleeping) bodies and is only redrawn when
+// the cascade moves or that set changes, and moving bodies are drawn over a
+// copy of it.
+void renderShadowMaps() {
+    GLint framebuffer = 0;
+    GLint viewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    beginShadowPass(shadowCascades);
+    for (int i = 0; i < kShadowCachedCascade; ++i) {
+        bindShadowCascade(shadowCascades, i);
+        shadowCasterCounts[i] = drawShadowCasters(i, kCastersAll);
+    }
+    const bool movingInFar = movingCastersInFar;
+    shadowCacheRendered = shadowCacheStale(shadowCascades, restingCasterIds);
+    if (shadowCacheRendered) {
+        bindShadowCache(shadowCascades);
+        drawShadowCasters(kShadowCachedCascade, kCastersResting);
+    }
+    // The far layer only changes when the cache did or moving casters were or
+    // are in it.
+    shadowCasterCounts[kShadowCachedCascade] = restingCasterIds.size();
+    if (shadowCacheRendered || movingInFar || shadowCascades.farLayerHasMovingCasters) {
+        copyShadowCache(shadowCascades);
+        if (movingInFar)
+            shadowCasterCounts[kShadowCachedCascade] += drawShadowCasters(kShadowCachedCascade, kCastersMoving);
+    }
+    shadowCascades.farLayerHasMovingCasters = movingInFar;
+    endShadowPass();
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(framebuffer));
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+// Draws the ground, the dynamic bodies and the physics debug view into the
+// bound framebuffer. Shared by the windowed loop and headless runs.
+void renderScene() {
+    glClearColor(backgroundColor.x, backgroundColor.y, backgroundColor.z, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    viewMatrix = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+    glm::mat4 viewProj = projectionMatrix * viewMatrix;
+    {
+        // The menu slider can zero the direction; fall back to straight down.
+        glm::vec3 direction = glm::length(lightDirection) > 1e-4f ? glm::normalize(lightDirection) : glm::vec3(0.0f, -1.0f, 0.0f);
+        const bool shadows = sceneLighting && shadowsEnabled && !governorShed(frameGovernor, GovernorStep::Shadows);
+        // Shadow casters are gathered and culled on the job system while the
+        // light clusters are built here.
+        JobCounter shadowCastersReady;
+        if (shadows)
+            queueShadowCasters(direction, shadowCastersReady);
+        // Cluster tiles are in framebuffer pixels, so follow the bound viewport.
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        beginProfilerPhase(frameProfiler, profileLightClusters);
+        gatherPointLights();
+        buildLightClusters(lightClusters, pointLights, viewMatrix, projectionMatrix, kCameraNear, kCameraFar,
+                           viewport[2], viewport[3]);
+        bindLightClusters(lightClusters);
+        endProfilerPhase(frameProfiler, profileLightClusters);
+        if (shadows) {
+            beginProfilerPhase(frameProfiler, profileShadows);
+            jobSystem.wait(shadowCastersReady);
+            renderShadowMaps();
+            endProfilerPhase(frameProfiler, profileShadows);
+        } else {
+            invalidateShadowCache(shadowCascades);
+        }
+        bindShadowMap(shadowCascades);
+        FrameUniforms frameUniforms;
+        frameUniforms.viewProj = viewProj;
+        frameUniforms.view = viewMatrix;
+        frameUniforms.lightDirection = glm::vec4(glm::mat3(viewMatrix) * direction, 0.0f);
+        frameUniforms.lightColor = glm::vec4(0.8f, 0.78f, 0.72f, 0.0f);
+        frameUniforms.ambientColor = glm::vec4(0.3f, 0.32f, 0.38f, 0.0f);
+        frameUniforms.clusterScale = lightClusters.shaderScale;
+        frameUniforms.clusterGrid = glm::ivec4(kClusterTilesX, kClusterTilesY, kClusterSlices, 0);
+        for (int i = 0; i < kShadowCascadeCount; ++i)
+            frameUniforms.shadowMatrices[i] = shadowReceiverMatrix(shadowCascades.cascades[i], viewMatrix);
+        frameUniforms.shadowSplits = glm::vec4(shadowCascades.cascades[0].splitDepth, shadowCascades.cascades[1].splitDepth,
+                                               shadowCascades.cascades[2].splitDepth, shadows ? 1.0f : 0.0f);
+        frameUniforms.shadowTexelSizes = glm::vec4(shadowCascades.cascades[0].texelSize, shadowCascades.cascades[1].texelSize,
+                                                   shadowCascades.cascades[2].texelSize, 0.0f);
+        glBindBuffer(GL_UNIFORM_BUFFER, frameUniformBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frameUniforms);
+    }
+    const size_t entityRows = collectEntityChunks(sceneEntities, kComponentTransform | kComponentRenderMesh | kComponentColor,
+                                                  entityChunks);
+    clearRenderQueue(renderQueue);
+    // Reserved for the entities plus the ground and debug lines, so the arena
+    // never holds an outgrown copy.
+    renderObjects = FrameVector<RenderObject>(FrameAllocator<RenderObject>(threadFrameArena()));
+    renderObjects.reserve(entityRows + 2);
+    clearMeshBatch(meshBatch);
+    // Ground
+    {
+        RenderObject ground;
+        ground.model = glm::mat4(1.0f);
+        ground.boundingRadius = 0.0f;
+        ground.shader = kRenderShaderGround;
+        ground.mesh = 0;
+        ground.material = kMaterialGround;
+        ground.color = materialColors[kMaterialGround];
+        queueRenderObject(RenderPass::Opaque, ground, 0.0f);
+    }
+    // Entities. Meshes go to the mesh batch, except LOD spheres in impostor
+    // mode, which go to the impostor renderer. Each chunk packs straight into
+    // its own slice of the render objects and queue items.
+    const float pixelsPerUnit = projectionMatrix[1][1] * windowHeight * 0.5f;
+    const bool useImpostors = sphereRenderMode == SphereRenderMode::Impostor;
+    // The governor's coarser LODs halve the bias.
+    const float lodBias = governorShed(frameGovernor, GovernorStep::SphereLod) ? sphereLodBias * 0.5f : sphereLodBias;
+    const size_t objectBase = renderObjects.size();
+    const size_t itemBase = renderQueue.items.size();
+    renderObjects.resize(objectBase + entityRows);
+    renderQueue.items.resize(itemBase + entityRows);
+    parallelForEntityChunks(jobSystem, entityChunks, [&](const EntityChunk& chunk) {
+        for (uint32_t i = 0; i < chunk.count; ++i) {
+            const RenderMesh& mesh = chunk.meshes[i];
+            const SceneMesh& sceneMesh = sceneMeshes[mesh.mesh];
+            const float viewDistance = glm::length(glm::vec3(chunk.transforms[i][3]) - cameraPos);
+            RenderObject& object = renderObjects[objectBase + chunk.first + i];
+            object.model = glm::scale(chunk.transforms[i], mesh.scale);
+            object.boundingRadius = mesh.boundingRadius;
+            object.shader = kRenderShaderMeshBatch;
+            object.mesh = sceneMesh.batchCommand;
+            object.material = sceneMesh.material;
+            object.color = chunk.colors[i];
+            if (sceneMesh.sphereLod && useImpostors) {
+                object.shader = kRenderShaderSphereImpostor;
+                object.mesh = 0;
+            } else if (sceneMesh.sphereLod) {
+                float screenRadius = projectedSphereRadius(mesh.boundingRadius, viewDistance, pixelsPerUnit);
+                object.mesh = sphereLodBatchCommands[selectSphereLod(screenRadius, lodBias)];
+            }
+            RenderQueueItem& item = renderQueue.items[itemBase + chunk.first + i];
+            item.key = makeSortKey(RenderPass::Opaque, object.shader, object.mesh, object.material, viewDistance / kCameraFar);
+            item.payload = static_cast<uint32_t>(objectBase + chunk.first + i);
+        }
+    });
+    if (debugDrawer.getDebugMode() != btIDebugDraw::DBG_NoDebug && !governorShed(frameGovernor, GovernorStep::DebugDraw)) {
+        RenderObject debugLines;
+        debugLines.model = glm::mat4(1.0f);
+        debugLines.boundingRadius = 0.0f;
+        debugLines.shader = kRenderShaderDebugLines;
+        debugLines.mesh = 0;
+        debugLines.material = 0;
+        debugLines.color = glm::vec3(1.0f);
+        queueRenderObject(RenderPass::Debug, debugLines, 0.0f);
+    }
+    sortRenderQueue(renderQueue);
+
+    // Submit one run per (pass, shader); the profiler phase changes with the run.
+    const std::vector<RenderQueueItem>& items = renderQueue.items;
+    renderQueueRuns = 0;
+    int activePhase = -1;
+    size_t runStart = 0;
+    while (runStart < items.size()) {
+        const RenderPass pass = sortKeyPass(items[runStart].key);
+        const uint32_t shader = renderObjects[items[runStart].payload].shader;
+        size_t runEnd = runStart + 1;
+        while (runEnd < items.size() && sortKeyPass(items[runEnd].key) == pass &&
+               renderObjects[items[runEnd].payload].shader == shader)
+            ++runEnd;
+        const int phase = profilePhaseForShader(shader);
+        if (phase != activePhase) {
+            if (activePhase >= 0)
+                endProfilerPhase(frameProfiler, activePhase);
+            beginProfilerPhase(frameProfiler, phase);
+            activePhase = phase;
+        }
+        submitRenderRun(shader, runStart, runEnd, viewProj);
+        ++renderQueueRuns;
+        runStart = runEnd;
+    }
+    if (activePhase >= 0)
+        endProfilerPhase(frameProfiler, activePhase);
+}
 
 // --- Main Function ---
-int main() {
-    // Initialize GLFW
-    if (!glfwInit()) {
-        std::cerr << "GLFW initialization failed!" << std::endl;
+int main(int argc, char** argv) {
+    // Before anything in Bullet allocates.
+    installBulletAllocator();
+    // Settings come from the command line and any config files it names; see
+    // engine_config.h, or run with --help.
+    EngineConfig config;
+    const ConfigResult configResult = parseEngineArguments(config, argc, argv);
+    if (configResult == ConfigResult::Error)
         return -1;
-    }
-    // Set up OpenGL context (3.3 core)
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (configResult == ConfigResult::Exit)
+        return 0;
+    const bool headless = config.headless;
+    // Frames to run; 0 runs until the window closes or the time limit.
+    const int runFrames = config.frames > 0 ? config.frames : (headless && config.seconds <= 0.0f ? 120 : 0);
+    int exitCode = 0;
+    windowWidth = config.windowWidth;
+    windowHeight = config.windowHeight;
+    lastX = windowWidth / 2.0f;
+    lastY = windowHeight / 2.0f;
+    worldGravity = config.gravity;
+    simulationStep = config.timeStep;
+    physicsSubsteps = config.substeps;
+    solverIterations = config.solverIterations;
+    physicsPoolSettings = config.pools;
+    sphereRenderMode = config.impostors ? SphereRenderMode::Impostor : SphereRenderMode::MeshLod;
+    gpuFrustumCull = config.gpuCull;
+    sceneLighting = config.lighting;
+    pointLightsEnabled = config.pointLights;
+    shadowsEnabled = config.shadows;
+    shadowDistance = config.shadowDistance;
+    frameGovernor.settings = config.governor;
+    // A frame-limited run has to keep producing frames.
+    idleModeEnabled = config.idle && runFrames == 0;
+    if (!config.capturePath.empty())
+        frameCaptureSettings.path = config.capturePath;
+    // Workers for every core but this thread's, unless the config names a
+    // thread count. Bullet numbers threads in the order they first run its
+    // work, so the scheduler is installed before any worker can.
+    const int threads = config.threads > 0 ? config.threads : static_cast<int>(std::thread::hardware_concurrency());
+    jobSystem.start(threads - 1);
+    btSetTaskScheduler(&jobSystem);
+    HeadlessContext headlessContext;
+    RenderTarget headlessTarget;
+    if (headless) {
+        if (!createHeadlessContext(headlessContext))
+            return -1;
+        if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(headlessGetProcAddress))) {
+            std::cerr << "Failed to initialize GLAD!" << std::endl;
+            return -1;
+        }
+        if (!createRenderTarget(headlessTarget, windowWidth, windowHeight))
+            return -1;
+        bindRenderTarget(headlessTarget);
+    } else {
+        // Initialize GLFW
+        if (!glfwInit()) {
+            std::cerr << "GLFW initialization failed!" << std::endl;
+            return -1;
+        }
+        // Set up OpenGL context: 4.3 core for multi-draw indirect if the driver has
+        // it, otherwise 3.3 core with the instanced path.
+        const int contextVersions[][2] = { { 4, 3 }, { 3, 3 } };
+        for (const auto& version : contextVersions) {
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, version[0]);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, version[1]);
+            glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+            glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
-    // Create window
-    window = glfwCreateWindow(windowWidth, windowHeight, "Minimal Game Engine with GUI", nullptr, nullptr);
-    if (!window) {
-        std::cerr << "Failed to create GLFW window!" << std::endl;
-        glfwTerminate();
-        return -1;
-    }
-    glfwMakeContextCurrent(window);
-    // Set callbacks
-    glfwSetCursorPosCallback(window, combinedCursorPosCallback);
-    glfwSetMouseButtonCallback(window, mouseButtonCallback);
-    glfwSetKeyCallback(window, keyCallback);
-    // Start in FPS mode if guiInputMode is false; otherwise, in GUI mode.
-    if (guiInputMode)
-        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
-    else {
-        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-        firstMouse = true;
-    }
-    // Initialize GLAD
-    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
-        std::cerr << "Failed to initialize GLAD!" << std::endl;
-        return -1;
+            // Create window
+            window = glfwCreateWindow(windowWidth, windowHeight, "Minimal Game Engine with GUI", nullptr, nullptr);
+            if (window)
+                break;
+        }
+        if (!window) {
+            std::cerr << "Failed to create GLFW window!" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+        // Set callbacks
+        glfwSetCursorPosCallback(window, combinedCursorPosCallback);
+        glfwSetMouseButtonCallback(window, mouseButtonCallback);
+        glfwSetKeyCallback(window, keyCallback);
+        // Start in FPS mode if guiInputMode is false; otherwise, in GUI mode.
+        if (guiInputMode)
+            glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+        else {
+            glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+            firstMouse = true;
+        }
+        // Initialize GLAD
+        if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
+            std::cerr << "Failed to initialize GLAD!" << std::endl;
+            return -1;
+        }
+        glViewport(0, 0, windowWidth, windowHeight);
     }
-    glViewport(0, 0, windowWidth, windowHeight);
     glEnable(GL_DEPTH_TEST);
-    // Create shader program
-    shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
-    // Setup meshes
-    setupCubeMesh();
-    sphereMesh = createSphereMesh();
+    // Create shader programs, loading linked binaries from the cache when possible
+    initShaderProgramCache("shader_cache");
+    groundGridShaders.name = "ground grid";
+    groundGridShaders.commonBody = frameShaderCommonSource;
+    groundGridShaders.vertexBody = groundGridVertexShaderSource;
+    groundGridShaders.fragmentBody = groundGridFragmentShaderSource;
+    groundGridShaders.features = groundGridShaderFeatures;
+    groundGridShaders.featureCount = sizeof(groundGridShaderFeatures) / sizeof(groundGridShaderFeatures[0]);
+    groundGridShaders.samplers = litShaderSamplers;
+    groundGridShaders.samplerCount = sizeof(litShaderSamplers) / sizeof(litShaderSamplers[0]);
+    warmShaderVariants(groundGridShaders, &kGroundGridFeatureLighting, 1);
+    debugLineProgram = createShaderProgram(debugLineVertexShaderSource, debugLineFragmentShaderSource);
+    meshBatchShaders.name = "mesh batch";
+    meshBatchShaders.vertexBody = meshBatchVertexShaderSource;
+    meshBatchShaders.fragmentBody = meshBatchFragmentShaderSource;
+    meshBatchShaders.features = meshBatchShaderFeatures;
+    meshBatchShaders.featureCount = sizeof(meshBatchShaderFeatures) / sizeof(meshBatchShaderFeatures[0]);
+    meshBatchShaders.commonBody = frameShaderCommonSource;
+    meshBatchShaders.samplers = litShaderSamplers;
+    meshBatchShaders.samplerCount = sizeof(litShaderSamplers) / sizeof(litShaderSamplers[0]);
+    if (meshBatchSupportsIndirect()) {
+        meshBatchCullProgram = createComputeProgram(meshBatchCullComputeShaderSource);
+        if (config.indirect)
+            meshBatchPath = MeshBatchPath::MultiDrawIndirect;
+    } else if (config.indirect) {
+        std::cout << "Multi-draw indirect needs GL 4.3; using the instanced path" << std::endl;
+    }
+    {
+        // Only the default lit variants (boxes and spheres) are linked up front;
+        // debug views link on first use.
+        const uint32_t pathFeature = meshBatchPath == MeshBatchPath::MultiDrawIndirect ? kMeshBatchFeatureIndirect : 0;
+        const uint32_t batchVariants[] = {
+            pathFeature | kMeshBatchFeatureLighting,
+            pathFeature | kMeshBatchFeatureLighting | kMeshBatchFeatureUnitSphereNormals
+        };
+        warmShaderVariants(meshBatchShaders, batchVariants, 2);
+    }
+    glGenBuffers(1, &frameUniformBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, frameUniformBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, kFrameUniformBinding, frameUniformBuffer);
+    sphereImpostorShaders.name = "sphere impostor";
+    sphereImpostorShaders.vertexBody = sphereImpostorVertexShaderSource;
+    sphereImpostorShaders.fragmentBody = sphereImpostorFragmentShaderSource;
+    sphereImpostorShaders.features = sphereImpostorShaderFeatures;
+    sphereImpostorShaders.featureCount = sizeof(sphereImpostorShaderFeatures) / sizeof(sphereImpostorShaderFeatures[0]);
+    sphereImpostorShaders.commonBody = frameShaderCommonSource;
+    sphereImpostorShaders.samplers = litShaderSamplers;
+    sphereImpostorShaders.samplerCount = sizeof(litShaderSamplers) / sizeof(litShaderSamplers[0]);
+    {
+        const ShaderCacheStats& shaderStats = getShaderCacheStats();
+        std::cout << "Shader programs: " << shaderStats.programsFromCache << " from cache, "
+                  << shaderStats.programsCompiled << " compiled, " << shaderStats.totalMilliseconds << " ms ("
+                  << (shaderStats.programsCompiled == 0 ? "warm" : "cold") << " cache)" << std::endl;
+    }
+    // Setup meshes: build everything into the arena, upload once, then create VAOs.
+    cubeMesh = addMeshToArena(meshArena, "cube", meshFromTriangleSoup(cubeVertices, sizeof(cubeVertices) / (3 * sizeof(float))));
+    addSphereLodMeshes(sphereLodChain, meshArena);
+    uploadMeshArena(meshArena);
+    printMeshArenaReport(meshArena);
+    cubeBatchCommand = addMeshBatchCommand(meshBatch, cubeMesh);
+    for (int level = 0; level < kSphereLodCount; ++level)
+        sphereLodBatchCommands[level] = addMeshBatchCommand(meshBatch, sphereLodChain.levels[level],
+                                                            kMeshBatchFeatureUnitSphereNormals);
+    setupMeshBatch(meshBatch, meshArena);
+    shadowCubeCommand = addMeshBatchCommand(shadowBatch, cubeMesh);
+    shadowSphereCommand = addMeshBatchCommand(shadowBatch, sphereLodChain.levels[1]);
+    setupMeshBatch(shadowBatch, meshArena);
+    sceneMeshes[kSceneMeshBox] = { cubeBatchCommand, shadowCubeCommand, kMaterialBox, false };
+    sceneMeshes[kSceneMeshSphere] = { sphereLodBatchCommands[0], shadowSphereCommand, kMaterialSphere, true };
+    if (!createShadowCascades(shadowCascades, 2048))
+        shadowsEnabled = false;
+    sphereImpostorRenderer = createSphereImpostorRenderer();
+    groundGridRenderer = createGroundGridRenderer();
+    lightClusters = createLightClusterGrid();
+    profilePhysics = addProfilerPhase(frameProfiler, "Physics", false);
+    profileLightClusters = addProfilerPhase(frameProfiler, "Light Clusters", false);
+    profileShadows = addProfilerPhase(frameProfiler, "Shadows", true);
+    profileGround = addProfilerPhase(frameProfiler, "Ground", true);
+    profileBodies = addProfilerPhase(frameProfiler, "Dynamic Bodies", true);
+    profileDebugDraw = addProfilerPhase(frameProfiler, "Debug Draw", true);
+    profileImGui = addProfilerPhase(frameProfiler, "ImGui", true);
     // Initialize Bullet Physics
     dynamicsWorld = initPhysics();
+    debugDrawer.setup();
+    dynamicsWorld->setDebugDrawer(&debugDrawer);
     // Create a static ground plane
-    btCollisionShape* groundShape = new btStaticPlaneShape(btVector3(0, 1, 0), 0);
+    btCollisionShape* groundShape = acquirePlaneShape(shapeRegistry, btVector3(0, 1, 0), 0);
     btTransform groundTransform;
     groundTransform.setIdentity();
     groundTransform.setOrigin(btVector3(0, 0, 0));
     btRigidBody* groundBody = createRigidBody(groundShape, 0.f, groundTransform);
-    collisionShapes.push_back(groundShape);
-    // Create collision shapes for dynamic bodies
-    btCollisionShape* boxShape = new btBoxShape(btVector3(1, 1, 1));
-    collisionShapes.push_back(boxShape);
-    btCollisionShape* sphereShape = new btSphereShape(0.5f);
-    collisionShapes.push_back(sphereShape);
-    // Create some initial dynamic boxes and spheres
-    for (int i = 0; i < 5; ++i) {
-        btTransform transform;
-        transform.setIdentity();
-        transform.setOrigin(btVector3(-5 + i * 2.5, 5, 0));
-        btRigidBody* body = createRigidBody(boxShape, 1.0f, transform);
-        globalDynamicBodies.push_back(body);
-    }
-    for (int i = 0; i < 5; ++i) {
-        btTransform transform;
-        transform.setIdentity();
-        transform.setOrigin(btVector3(-5 + i * 2.5, 8, 3));
-        btRigidBody* body = createRigidBody(sphereShape, 1.0f, transform);
-        globalDynamicBodies.push_back(body);
+    // The initial dynamic boxes and spheres
+    {
+        std::vector<ScenePlacement> placements;
+        generateScene(config.scene, placements);
+        const btScalar halfExtent = config.scene.boxHalfExtent;
+        for (const ScenePlacement& placement : placements) {
+            if (placement.sphere)
+                spawnSphere(config.scene.sphereRadius, materialColors[kMaterialSphere], placement.position, 0.0f);
+            else
+                spawnBox(btVector3(halfExtent, halfExtent, halfExtent), materialColors[kMaterialBox], placement.position, 0.0f);
+        }
     }
     // Setup camera matrices
-    projectionMatrix = glm::perspective(glm::radians(45.0f),
+    projectionMatrix = glm::perspective(glm::radians(kCameraFovDegrees),
                                         static_cast<float>(windowWidth) / windowHeight,
-                                        0.1f, 1000.0f);
+                                        kCameraNear, kCameraFar);
     viewMatrix = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+    // Headless run: fixed steps, every frame rendered offscreen, the last one
+    // read back and written out.
+    if (headless) {
+        if (!config.captureFormat.empty()) {
+            // Offline runs wait for the encoder rather than dropping frames.
+            frameCaptureSettings.format = config.captureFormat == "y4m" ? CaptureFormat::Y4m : CaptureFormat::Png;
+            frameCaptureSettings.dropWhenBehind = false;
+            frameCapture.start(headlessTarget.width, headlessTarget.height, frameCaptureSettings, jobSystem);
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        uint64_t steadyStateAllocations = 0;
+        int frame = 0;
+        for (; runFrames == 0 || frame < runFrames; ++frame) {
+            if (config.seconds > 0.0f &&
+                std::chrono::steady_clock::now() - start >= std::chrono::duration<float>(config.seconds))
+                break;
+            beginProfilerFrame(frameProfiler);
+            stepScene();
+            if (config.steadyAfter >= 0 && frame >= config.steadyAfter)
+                steadyStateAllocations += physicsStepAllocations;
+            renderScene();
+            frameCapture.captureFrame(headlessTarget.framebuffer);
+            // Stands in for the buffer swap: submits the frame so timer queries and
+            // capture fences complete without anyone waiting on them.
+            glFlush();
+            endFrameArenas();
+        }
+        frameCapture.stop();
+        std::vector<unsigned char> pixels;
+        readRenderTarget(headlessTarget, pixels);
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Headless: " << frame << " frames in " << milliseconds << " ms" << std::endl;
+        for (const ProfilerPhase& phase : frameProfiler.phases) {
+            std::cout << "  " << phase.name << ": CPU " << phase.cpuMilliseconds << " ms";
+            if (phase.gpuTimed)
+                std::cout << ", GPU " << phase.gpuMilliseconds << " ms";
+            std::cout << std::endl;
+        }
+        const FrameArenaStats arenaStats = getFrameArenaStats();
+        std::cout << "  Frame arenas: peak " << arenaStats.peakFrameBytes / 1024.0 << " KB, average "
+                  << arenaStats.averageFrameBytes / 1024.0 << " KB per frame" << std::endl;
+        const BulletAllocatorStats physicsMemory = getBulletAllocatorStats();
+        std::cout << "  Physics memory: " << physicsMemory.liveBytes / 1024.0 << " KB live in "
+                  << physicsMemory.liveBlocks << " blocks, " << physicsMemory.allocations << " allocations" << std::endl;
+        const PhysicsPoolStats poolStats = getPhysicsPoolStats(*collisionConfiguration, *collisionDispatcher);
+        std::cout << "  Contact pools: " << poolStats.manifoldsUsed << " / " << poolStats.manifoldCapacity
+                  << " manifolds, " << poolStats.collisionAlgorithmsUsed << " / " << poolStats.collisionAlgorithmCapacity
+                  << " algorithms, " << poolStats.overflows << " overflows" << std::endl;
+        if (steadyStateAllocations > 0) {
+            std::cerr << "Headless: " << steadyStateAllocations << " Bullet allocations in steady state (from frame "
+                      << config.steadyAfter << ")" << std::endl;
+            exitCode = 1;
+        }
+        if (writePpm(config.output, headlessTarget.width, headlessTarget.height, pixels)) {
+            std::cout << "Wrote " << config.output << std::endl;
+        } else {
+            std::cerr << "Headless: failed to write " << config.output << std::endl;
+            exitCode = 1;
+        }
+    }
     // --- Initialize Dear ImGui ---
-    IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
-    ImGuiIO& io = ImGui::GetIO(); (void)io;
-    ImGui::StyleColorsDark();
-    ImGui_ImplGlfw_InitForOpenGL(window, true);
-    ImGui_ImplOpenGL3_Init("#version 330");
+    if (!headless) {
+        IMGUI_CHECKVERSION();
+        ImGui::CreateContext();
+        ImGuiIO& io = ImGui::GetIO(); (void)io;
+        ImGui::StyleColorsDark();
+        ImGui_ImplGlfw_InitForOpenGL(window, true);
+        ImGui_ImplOpenGL3_Init("#version 330");
+    }
     // Main loop
-    while (!glfwWindowShouldClose(window)) {
+    const double runStart = headless ? 0.0 : glfwGetTime();
+    int windowedFrames = 0;
+    while (!headless && !glfwWindowShouldClose(window)) {
+        // Run limits from the config end the run like closing the window.
+        if ((runFrames > 0 && windowedFrames >= runFrames) ||
+            (config.seconds > 0.0f && glfwGetTime() - runStart >= config.seconds))
+            break;
+        if (idleModeEnabled && idleCountdown == 0) {
+            const double waitStart = glfwGetTime();
+            // Never past the run's time limit. The limit can run out since the
+            // check above, and GLFW rejects a timeout that is not positive.
+            const double remaining = config.seconds > 0.0f ? config.seconds - (waitStart - runStart) : kIdleWaitSeconds;
+            if (remaining <= 0.0)
+                break;
+            const double timeout = std::min(kIdleWaitSeconds, remaining);
+            glfwWaitEventsTimeout(timeout);
+            const double waited = glfwGetTime() - waitStart;
+            recordIdleTime(waited);
+            // A full timeout with no input means no event came in: keep
+            // waiting. Anything else (input, resize, expose, an empty event)
+            // runs frames again.
+            if (inputQueueEmpty(inputQueue) && waited >= timeout)
+                continue;
+            idleCountdown = kIdleWakeFrames;
+            // The wait is not camera movement time.
+            lastFrame = static_cast<float>(glfwGetTime());
+        }
+        recordIdleTime(0.0);
         // Process camera movement (only in FPS mode)
-        processInput(window);
+        const bool cameraMoved = processInput(window);
+        beginProfilerFrame(frameProfiler);
+        applyInputEvents(window);
         // Step physics simulation
-        dynamicsWorld->stepSimulation(1.f / 60.f);
+        stepScene();
         // Start ImGui frame
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -502,18 +1794,177 @@ int main() {
                     addBox = true;
                 if (ImGui::MenuItem("Add Sphere"))
                     addSphere = true;
+                if (ImGui::MenuItem("Add 100 Light Emitters"))
+                    addLightEmitters = true;
                 if (ImGui::MenuItem("Delete Objects"))
                     deleteObjects = true;
+                ImGui::SliderFloat("Lifetime", &spawnLifetime, 0.0f, 30.0f, spawnLifetime > 0.0f ? "%.1f s" : "forever");
+                ImGui::SliderFloat("Box half extent", &spawnBoxHalfExtent, 0.25f, 3.0f, "%.2f");
+                ImGui::SliderFloat("Sphere radius", &spawnSphereRadius, 0.25f, 3.0f, "%.2f");
                 ImGui::EndMenu();
             }
             if (ImGui::BeginMenu("Options")) {
                 ImGui::MenuItem("Demo Window", NULL, &showDemoWindow);
+                ImGui::MenuItem("Performance Window", NULL, &showPerformanceWindow);
+                ImGui::MenuItem("Idle When Asleep", NULL, &idleModeEnabled);
+                if (ImGui::BeginMenu("Physics")) {
+                    ImGui::SliderInt("Substeps", &physicsSubsteps, 1, 8);
+                    ImGui::SliderInt("Solver Iterations", &solverIterations, 1, 50);
+                    ImGui::EndMenu();
+                }
+                if (ImGui::BeginMenu("Frame Budget")) {
+                    ImGui::MenuItem("Governor", NULL, &frameGovernor.settings.enabled);
+                    ImGui::SliderFloat("Target", &frameGovernor.settings.targetMilliseconds, 4.0f, 50.0f, "%.1f ms");
+                    ImGui::SliderFloat("Restore Below", &frameGovernor.settings.restoreRatio, 0.3f, 0.95f, "%.2f x target");
+                    ImGui::SliderInt("Shed After", &frameGovernor.settings.shedFrames, 1, 240, "%d frames");
+                    ImGui::SliderInt("Restore After", &frameGovernor.settings.restoreFrames, 30, 1200, "%d frames");
+                    ImGui::EndMenu();
+                }
+                if (ImGui::BeginMenu("Sphere Rendering")) {
+                    if (ImGui::MenuItem("Mesh LOD", NULL, sphereRenderMode == SphereRenderMode::MeshLod))
+                        sphereRenderMode = SphereRenderMode::MeshLod;
+                    if (ImGui::MenuItem("Ray-Cast Impostors", NULL, sphereRenderMode == SphereRenderMode::Impostor))
+                        sphereRenderMode = SphereRenderMode::Impostor;
+                    ImGui::EndMenu();
+                }
+                ImGui::SliderFloat("Sphere LOD Bias", &sphereLodBias, 0.25f, 4.0f);
+                if (ImGui::BeginMenu("Lighting")) {
+                    ImGui::MenuItem("Directional + Ambient", NULL, &sceneLighting);
+                    ImGui::SliderFloat3("Light Direction", &lightDirection.x, -1.0f, 1.0f);
+                    ImGui::MenuItem("Point Lights (Clustered)", NULL, &pointLightsEnabled, sceneLighting);
+                    ImGui::MenuItem("Cascaded Shadows", NULL, &shadowsEnabled, sceneLighting && shadowCascades.size > 0);
+                    ImGui::SliderFloat("Shadow Distance", &shadowDistance, 20.0f, 400.0f);
+                    ImGui::Text("Casters per cascade %zu / %zu / %zu; far cache %s, %llu redraws, %llu copies",
+                                shadowCasterCounts[0], shadowCasterCounts[1], shadowCasterCounts[2],
+                                shadowCacheRendered ? "redrawn" : "reused",
+                                static_cast<unsigned long long>(shadowCascades.cacheRenders),
+                                static_cast<unsigned long long>(shadowCascades.farLayerCopies));
+                    ImGui::Text("%zu lights, %zu visible, %zu cluster entries (max %u, %zu dropped), %.2f ms",
+                                countEntities(sceneEntities, kComponentLight), lightClusters.lastVisibleLights, lightClusters.lastIndexCount,
+                                lightClusters.lastMaxClusterLights, lightClusters.lastDroppedLights,
+                                lightClusters.lastAssignMilliseconds);
+                    ImGui::EndMenu();
+                }
+                if (ImGui::BeginMenu("Ground Grid")) {
+                    ImGui::SliderFloat("Cell Size", &groundGridCellSize, 0.25f, 10.0f);
+                    ImGui::SliderFloat("Fade Distance", &groundGridFadeDistance, 20.0f, 900.0f);
+                    ImGui::EndMenu();
+                }
+                if (ImGui::BeginMenu("Mesh Submission")) {
+                    if (ImGui::MenuItem("Instanced (GL 3.3)", NULL, meshBatchPath == MeshBatchPath::Instanced))
+                        meshBatchPath = MeshBatchPath::Instanced;
+                    if (ImGui::MenuItem("Multi-Draw Indirect (GL 4.3)", NULL,
+                                        meshBatchPath == MeshBatchPath::MultiDrawIndirect, meshBatchSupportsIndirect()))
+                        meshBatchPath = MeshBatchPath::MultiDrawIndirect;
+                    ImGui::MenuItem("GPU Frustum Cull", NULL, &gpuFrustumCull, meshBatchSupportsIndirect());
+                    ImGui::MenuItem("Normal Debug View", NULL, &meshNormalView);
+                    ImGui::EndMenu();
+                }
+                if (ImGui::BeginMenu("Physics Debug Draw")) {
+                    int mode = debugDrawer.getDebugMode();
+                    ImGui::CheckboxFlags("AABBs", &mode, btIDebugDraw::DBG_DrawAabb);
+                    ImGui::CheckboxFlags("Contact Points", &mode, btIDebugDraw::DBG_DrawContactPoints);
+                    ImGui::CheckboxFlags("Wireframe", &mode, btIDebugDraw::DBG_DrawWireframe);
+                    ImGui::CheckboxFlags("Constraints", &mode, btIDebugDraw::DBG_DrawConstraints | btIDebugDraw::DBG_DrawConstraintLimits);
+                    debugDrawer.setDebugMode(mode);
+                    if (ImGui::SliderInt("Line Cap", &debugDrawMaxLines, 1000, 2000000, "%d", ImGuiSliderFlags_Logarithmic))
+                        debugDrawer.setMaxLines(static_cast<size_t>(debugDrawMaxLines));
+                    ImGui::Text("%zu lines, %zu dropped", debugDrawer.getLineCount(), debugDrawer.getDroppedLineCount());
+                    ImGui::EndMenu();
+                }
+                if (ImGui::BeginMenu("Frame Capture")) {
+                    int framebufferWidth = 0, framebufferHeight = 0;
+                    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+                    if (ImGui::MenuItem("Record PNG Sequence", NULL, false, !frameCapture.isActive())) {
+                        frameCaptureSettings.format = CaptureFormat::Png;
+                        frameCaptureSettings.path = "capture_";
+                        frameCapture.start(framebufferWidth, framebufferHeight, frameCaptureSettings, jobSystem);
+                    }
+                    if (ImGui::MenuItem("Record Y4M Video", NULL, false, !frameCapture.isActive())) {
+                        frameCaptureSettings.format = CaptureFormat::Y4m;
+                        frameCaptureSettings.path = "capture.y4m";
+                        frameCapture.start(framebufferWidth, framebufferHeight, frameCaptureSettings, jobSystem);
+                    }
+                    if (ImGui::MenuItem("Stop Recording", NULL, false, frameCapture.isActive()))
+                        frameCapture.stop();
+                    FrameCaptureStats captureStats = frameCapture.getStats();
+                    ImGui::Text("Frame %.2f ms, capture %.3f ms on the render thread", 1000.0f / ImGui::GetIO().Framerate,
+                                captureStats.lastCaptureMilliseconds);
+                    ImGui::Text("%llu written, %zu queued, %llu dropped, %llu stalls, encode %.1f ms",
+                                static_cast<unsigned long long>(captureStats.framesWritten), captureStats.framesQueued,
+                                static_cast<unsigned long long>(captureStats.framesDropped),
+                                static_cast<unsigned long long>(captureStats.readbackStalls),
+                                captureStats.averageEncodeMilliseconds);
+                    ImGui::EndMenu();
+                }
                 ImGui::EndMenu();
             }
             ImGui::EndMainMenuBar();
         }
         if (showDemoWindow)
             ImGui::ShowDemoWindow(&showDemoWindow);
+        if (showPerformanceWindow) {
+            ImGui::Begin("Performance", &showPerformanceWindow);
+            ImGui::Text("Frame %.2f ms (%.0f FPS)", frameProfiler.frameMilliseconds,
+                        frameProfiler.frameMilliseconds > 0.0 ? 1000.0 / frameProfiler.frameMilliseconds : 0.0);
+            if (ImGui::BeginTable("phases", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV)) {
+                ImGui::TableSetupColumn("Phase");
+                ImGui::TableSetupColumn("CPU ms");
+                ImGui::TableSetupColumn("GPU ms");
+                ImGui::TableHeadersRow();
+                for (size_t i = 0; i < frameProfiler.phases.size(); ++i) {
+                    const ProfilerPhase& phase = frameProfiler.phases[i];
+                    // The ImGui phase of this frame has not run yet; it shows the last one.
+                    const bool active = profilerPhaseActive(frameProfiler, static_cast<int>(i)) ||
+                                        static_cast<int>(i) == profileImGui;
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(phase.name.c_str());
+                    ImGui::TableNextColumn();
+                    if (active)
+                        ImGui::Text("%.3f", phase.cpuMilliseconds);
+                    else
+                        ImGui::TextUnformatted("-");
+                    ImGui::TableNextColumn();
+                    if (active && phase.gpuTimed)
+                        ImGui::Text("%.3f", phase.gpuMilliseconds);
+                    else
+                        ImGui::TextUnformatted("-");
+                }
+                ImGui::EndTable();
+            }
+            ImGui::Text("GPU times lag %d frames; %llu late results dropped", kProfilerLatency,
+                        static_cast<unsigned long long>(frameProfiler.lateGpuResults));
+            const JobSystemStats jobStats = jobSystem.getStats();
+            ImGui::Text("Jobs: %d threads, %llu run, %llu stolen", jobStats.threads,
+                        static_cast<unsigned long long>(jobStats.jobsRun),
+                        static_cast<unsigned long long>(jobStats.jobsStolen));
+            ImGui::Text("Idle: %.0f%% of the last second", idlePercent);
+            if (ImGui::CollapsingHeader("Frame Budget")) {
+                ImGui::Text("%s: %.2f ms of %.1f ms (CPU work %.2f ms), %zu steps shed, restore wait x%d",
+                            frameGovernor.settings.enabled ? "Governor on" : "Governor off", frameGovernor.cost,
+                            frameGovernor.settings.targetMilliseconds, frameProfiler.workMilliseconds,
+                            frameGovernor.order.size(), frameGovernor.restoreBackoff);
+                for (int i = 0; i < kGovernorStepCount; ++i) {
+                    const GovernorStep step = static_cast<GovernorStep>(i);
+                    ImGui::Text("  %-20s %s", governorStepName(step), governorShed(frameGovernor, step) ? "shed" : "full");
+                }
+                ImGui::Text("%llu decisions", static_cast<unsigned long long>(frameGovernor.decisions));
+                ImGui::BeginChild("governorLog", ImVec2(0.0f, 120.0f), true);
+                for (auto it = frameGovernor.log.rbegin(); it != frameGovernor.log.rend(); ++it)
+                    ImGui::Text("%llu  %s", static_cast<unsigned long long>(it->frame), it->text.c_str());
+                ImGui::EndChild();
+            }
+            ImGui::Text("Input: %llu events, %llu cursor moves coalesced, %llu dropped",
+                        static_cast<unsigned long long>(inputQueue.consumed),
+                        static_cast<unsigned long long>(inputQueue.coalesced),
+                        static_cast<unsigned long long>(inputQueue.dropped.load()));
+            const FrameArenaStats arenaStats = getFrameArenaStats();
+            ImGui::Text("Frame arenas: %.1f KB last, %.1f KB peak, %.1f KB average (%.0f KB held, %d threads)",
+                        arenaStats.lastFrameBytes / 1024.0, arenaStats.peakFrameBytes / 1024.0,
+                        arenaStats.averageFrameBytes / 1024.0, arenaStats.reservedBytes / 1024.0, arenaStats.threads);
+            ImGui::End();
+        }
         // Simple editor window
         ImGui::Begin("Scene Editor");
         ImGui::Text("Camera Position: (%.2f, %.2f, %.2f)", cameraPos.x, cameraPos.y, cameraPos.z);
@@ -522,67 +1973,130 @@ int main() {
             yaw = -90.0f;
             pitch = 0.0f;
         }
+        ImGui::Text("Sphere LODs (20/80/320/1280 tris): %zu / %zu / %zu / %zu",
+                    meshBatch.buckets[sphereLodBatchCommands[0]].size(), meshBatch.buckets[sphereLodBatchCommands[1]].size(),
+                    meshBatch.buckets[sphereLodBatchCommands[2]].size(), meshBatch.buckets[sphereLodBatchCommands[3]].size());
+        ImGui::Text("Entities: %zu in %zu archetypes", sceneEntities.entityCount, sceneEntities.archetypes.size());
+        ImGui::Text("Collision shapes: %zu shared (%llu created), %llu inertia computations for %llu bodies",
+                    shapeRegistry.stats.shapes, static_cast<unsigned long long>(shapeRegistry.stats.shapesCreated),
+                    static_cast<unsigned long long>(shapeRegistry.stats.inertiaComputations),
+                    static_cast<unsigned long long>(shapeRegistry.stats.inertiaLookups));
+        ImGui::Text("Render queue: %zu items in %zu runs, %d radix passes", renderQueue.items.size(), renderQueueRuns,
+                    renderQueue.lastSortPasses);
+        ImGui::Text("Mesh batch: %zu instances, %zu draw calls, %zu program switches (%zu variants linked)",
+                    meshBatchInstanceCount(meshBatch), meshBatch.lastDrawCalls, meshBatch.lastProgramSwitches,
+                    meshBatchShaders.programs.size());
+        {
+            const ShaderCacheStats& shaderStats = getShaderCacheStats();
+            ImGui::Text("Shader programs: %d cached, %d compiled in %.1f ms%s", shaderStats.programsFromCache,
+                        shaderStats.programsCompiled, shaderStats.totalMilliseconds,
+                        shaderStats.enabled ? "" : " (binary cache unavailable)");
+        }
+        const BulletAllocatorStats physicsMemory = getBulletAllocatorStats();
+        ImGui::Text("Physics memory: %.1f KB live in %zu blocks (%.1f KB reserved), %llu allocations last step",
+                    physicsMemory.liveBytes / 1024.0, physicsMemory.liveBlocks, physicsMemory.reservedBytes / 1024.0,
+                    static_cast<unsigned long long>(physicsStepAllocations));
+        {
+            const PhysicsPoolStats poolStats = getPhysicsPoolStats(*collisionConfiguration, *collisionDispatcher);
+            ImGui::Text("Contact pools: %d / %d manifolds, %d / %d algorithms, %llu overflows last step (%llu total)",
+                        poolStats.manifoldsUsed, poolStats.manifoldCapacity, poolStats.collisionAlgorithmsUsed,
+                        poolStats.collisionAlgorithmCapacity, static_cast<unsigned long long>(physicsStepPoolOverflows),
+                        static_cast<unsigned long long>(poolStats.overflows));
+        }
+        if (ImGui::CollapsingHeader("Physics Memory")) {
+            if (ImGui::BeginTable("sizeClasses", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV)) {
+                ImGui::TableSetupColumn("Class");
+                ImGui::TableSetupColumn("Live blocks");
+                ImGui::TableSetupColumn("Live KB / reserved");
+                ImGui::TableSetupColumn("Allocations");
+                ImGui::TableHeadersRow();
+                for (const BulletSizeClassStats& sizeClass : physicsMemory.classes) {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    if (sizeClass.size > 0)
+                        ImGui::Text("%zu B", sizeClass.size);
+                    else
+                        ImGui::TextUnformatted("malloc");
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%zu", sizeClass.liveBlocks);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.1f / %.1f", sizeClass.liveBytes / 1024.0, sizeClass.reservedBytes / 1024.0);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%llu", static_cast<unsigned long long>(sizeClass.allocations));
+                }
+                ImGui::EndTable();
+            }
+        }
+        if (ImGui::CollapsingHeader("Mesh Arena")) {
+            ImGui::Text("%zu vertex bytes, %zu index bytes", meshArena.vertexBytes, meshArena.indexBytesUploaded);
+            for (const MeshArenaEntry& entry : meshArena.entries) {
+                ImGui::BulletText("%s: %zu -> %zu verts, %s-bit, ACMR %.2f -> %.2f", entry.name.c_str(),
+                                  entry.stats.sourceVertexCount, entry.stats.vertexCount,
+                                  entry.range.indexType == GL_UNSIGNED_SHORT ? "16" : "32",
+                                  entry.stats.acmrBefore, entry.stats.acmrAfter);
+            }
+        }
         ImGui::End();
         // Handle adding objects via GUI
         if (addBox) {
-            btTransform transform;
-            transform.setIdentity();
-            transform.setOrigin(btVector3(cameraPos.x, cameraPos.y, cameraPos.z - 5));
-            btRigidBody* body = createRigidBody(boxShape, 1.0f, transform);
-            globalDynamicBodies.push_back(body);
+            spawnBox(btVector3(spawnBoxHalfExtent, spawnBoxHalfExtent, spawnBoxHalfExtent), materialColors[kMaterialBox],
+                     cameraPos - glm::vec3(0.0f, 0.0f, 5.0f), spawnLifetime);
             addBox = false;
         }
         if (addSphere) {
-            btTransform transform;
-            transform.setIdentity();
-            transform.setOrigin(btVector3(cameraPos.x, cameraPos.y, cameraPos.z - 5));
-            btRigidBody* body = createRigidBody(sphereShape, 1.0f, transform);
-            globalDynamicBodies.push_back(body);
+            spawnSphere(spawnSphereRadius, materialColors[kMaterialSphere], cameraPos - glm::vec3(0.0f, 0.0f, 5.0f),
+                        spawnLifetime);
             addSphere = false;
         }
+        if (addLightEmitters) {
+            // A 10 x 10 layer of spheres in front of the camera, each carrying a light.
+            const glm::vec3 palette[] = {
+                glm::vec3(1.0f, 0.55f, 0.2f), glm::vec3(0.3f, 0.6f, 1.0f),
+                glm::vec3(1.0f, 0.25f, 0.5f), glm::vec3(0.4f, 1.0f, 0.45f)
+            };
+            for (int i = 0; i < 100; ++i) {
+                LightEmitter light;
+                light.radius = 6.0f;
+                light.color = palette[i % 4] * 1.5f;
+                spawnSphere(spawnSphereRadius, materialColors[kMaterialSphere],
+                            cameraPos + glm::vec3(-9.0f + (i % 10) * 2.0f, 0.0f, -10.0f - (i / 10) * 2.0f),
+                            spawnLifetime, &light);
+            }
+            addLightEmitters = false;
+        }
         if (deleteObjects) {
-            globalDynamicBodies.clear();
+            // Lights riding on the bodies go with them.
+            destroySceneEntities(kComponentBody);
             deleteObjects = false;
             addBox = false;
             addSphere = false;
+            addLightEmitters = false;
         }
-        // Render scene
-        glClearColor(0.1f, 0.1f, 0.15f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        viewMatrix = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
-        // Draw ground
-        {
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(0, -0.05f, 0));
-            model = glm::scale(model, glm::vec3(50, 0.1f, 50));
-            drawCube(model, glm::vec3(0.3f, 0.8f, 0.3f));
-        }
-        // Draw dynamic objects
-        for (btRigidBody* body : globalDynamicBodies) {
-            btTransform trans;
-            body->getMotionState()->getWorldTransform(trans);
-            btScalar m[16];
-            trans.getOpenGLMatrix(m);
-            glm::mat4 model = glm::make_mat4(m);
-            btCollisionShape* shape = body->getCollisionShape();
-            if (shape->getShapeType() == BOX_SHAPE_PROXYTYPE) {
-                model = glm::scale(model, glm::vec3(2.0f));
-                drawCube(model, glm::vec3(0.8f, 0.3f, 0.3f));
-            } else if (shape->getShapeType() == SPHERE_SHAPE_PROXYTYPE) {
-                model = glm::scale(model, glm::vec3(1.0f));
-                drawSphere(model, glm::vec3(0.3f, 0.3f, 0.8f), sphereMesh);
-            }
-        }
+        renderScene();
+        // Capture before the GUI is drawn on top.
+        frameCapture.captureFrame(0);
         // Render ImGui
+        beginProfilerPhase(frameProfiler, profileImGui);
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        endProfilerPhase(frameProfiler, profileImGui);
+        endProfilerWork(frameProfiler);
+        governFrame();
         glfwSwapBuffers(window);
+        endFrameArenas();
+        const bool active = cameraMoved || !inputEvents.empty() || ImGui::IsAnyItemActive() ||
+                            frameCapture.isActive() || pickConstraint || !sceneAsleep();
+        idleCountdown = active ? kIdleWakeFrames : std::max(idleCountdown - 1, 0);
+        ++windowedFrames;
         glfwPollEvents();
     }
+    frameCapture.stop();
     // Cleanup ImGui
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
+    if (!headless) {
+        ImGui_ImplOpenGL3_Shutdown();
+        ImGui_ImplGlfw_Shutdown();
+        ImGui::DestroyContext();
+    }
     // Cleanup Bullet objects
     for (int i = dynamicsWorld->getNumCollisionObjects() - 1; i >= 0; --i) {
         btCollisionObject* obj = dynamicsWorld->getCollisionObjectArray()[i];
@@ -592,17 +2106,32 @@ int main() {
         dynamicsWorld->removeCollisionObject(obj);
         delete obj;
     }
-    delete groundShape;
-    delete boxShape;
-    delete sphereShape;
+    clearEntityWorld(sceneEntities);
+    clearShapeRegistry(shapeRegistry);
     delete dynamicsWorld;
+    btSetTaskScheduler(nullptr);
+    jobSystem.stop();
     // Cleanup OpenGL resources
-    glDeleteVertexArrays(1, &cubeVAO);
-    glDeleteBuffers(1, &cubeVBO);
-    glDeleteVertexArrays(1, &sphereMesh.VAO);
-    glDeleteBuffers(1, &sphereMesh.VBO);
-    glDeleteBuffers(1, &sphereMesh.EBO);
-    glDeleteProgram(shaderProgram);
-    glfwTerminate();
-    return 0;
+    destroyMeshArena(meshArena);
+    destroyMeshBatch(meshBatch);
+    destroyMeshBatch(shadowBatch);
+    destroyShadowCascades(shadowCascades);
+    debugDrawer.destroy();
+    destroyFrameProfiler(frameProfiler);
+    destroySphereImpostorRenderer(sphereImpostorRenderer);
+    destroyGroundGridRenderer(groundGridRenderer);
+    destroyShaderVariants(groundGridShaders);
+    destroyLightClusterGrid(lightClusters);
+    destroyShaderVariants(meshBatchShaders);
+    glDeleteBuffers(1, &frameUniformBuffer);
+    glDeleteProgram(meshBatchCullProgram);
+    glDeleteProgram(debugLineProgram);
+    destroyShaderVariants(sphereImpostorShaders);
+    if (headless) {
+        destroyRenderTarget(headlessTarget);
+        destroyHeadlessContext(headlessContext);
+    } else {
+        glfwTerminate();
+    }
+    return exitCode;
 }
@@ -0,0 +1,88 @@
+// mesh_arena.cpp
+// Packing meshes into the shared arena buffers and binding them to VAOs.
+
+#include "mesh_arena.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+MeshRange addMeshToArena(MeshArena& arena, const char* name, MeshData mesh) {
+    MeshArenaEntry entry;
+    entry.name = name;
+    entry.stats = optimizeMesh(mesh);
+
+    MeshRange& range = entry.range;
+    range.baseVertex = static_cast<GLint>(arena.vertices.size());
+    range.indexCount = static_cast<GLsizei>(mesh.indices.size());
+    const bool shortIndices = mesh.positions.size() <= 65536;
+    range.indexType = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    const size_t indexSize = shortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    // Keep every range aligned to its index size.
+    size_t offset = arena.indexBytes.size();
+    offset = (offset + indexSize - 1) / indexSize * indexSize;
+    range.indexByteOffset = static_cast<GLintptr>(offset);
+    arena.indexBytes.resize(offset + mesh.indices.size() * indexSize);
+    unsigned char* dst = arena.indexBytes.data() + offset;
+    if (shortIndices) {
+        for (size_t i = 0; i < mesh.indices.size(); ++i) {
+            uint16_t index = static_cast<uint16_t>(mesh.indices[i]);
+            std::memcpy(dst + i * sizeof(uint16_t), &index, sizeof(uint16_t));
+        }
+    } else {
+        std::memcpy(dst, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+    }
+
+    std::vector<PackedVertex> packed = packVertices(mesh);
+    arena.vertices.insert(arena.vertices.end(), packed.begin(), packed.end());
+    arena.entries.push_back(entry);
+    return range;
+}
+
+void uploadMeshArena(MeshArena& arena) {
+    if (!arena.VBO)
+        glGenBuffers(1, &arena.VBO);
+    if (!arena.EBO)
+        glGenBuffers(1, &arena.EBO);
+    arena.vertexBytes = arena.vertices.size() * sizeof(PackedVertex);
+    arena.indexBytesUploaded = arena.indexBytes.size();
+    glBindBuffer(GL_ARRAY_BUFFER, arena.VBO);
+    glBufferData(GL_ARRAY_BUFFER, arena.vertexBytes, arena.vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // The element binding is VAO state, so upload through a copy target.
+    glBindBuffer(GL_COPY_WRITE_BUFFER, arena.EBO);
+    glBufferData(GL_COPY_WRITE_BUFFER, arena.indexBytesUploaded, arena.indexBytes.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    std::vector<PackedVertex>().swap(arena.vertices);
+    std::vector<unsigned char>().swap(arena.indexBytes);
+}
+
+void bindMeshArenaAttributes(const MeshArena& arena) {
+    glBindBuffer(GL_ARRAY_BUFFER, arena.VBO);
+    glVertexAttribPointer(kMeshAttribPosition, 3, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex),
+                          reinterpret_cast<void*>(offsetof(PackedVertex, position)));
+    glVertexAttribPointer(kMeshAttribNormal, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex),
+                          reinterpret_cast<void*>(offsetof(PackedVertex, normal)));
+    glEnableVertexAttribArray(kMeshAttribPosition);
+    glEnableVertexAttribArray(kMeshAttribNormal);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.EBO);
+}
+
+void destroyMeshArena(MeshArena& arena) {
+    glDeleteBuffers(1, &arena.VBO);
+    glDeleteBuffers(1, &arena.EBO);
+    arena = MeshArena();
+}
+
+void printMeshArenaReport(const MeshArena& arena) {
+    std::cout << "Mesh arena: " << arena.entries.size() << " meshes, "
+              << arena.vertexBytes << " vertex bytes, " << arena.indexBytesUploaded << " index bytes" << std::endl;
+    for (const MeshArenaEntry& entry : arena.entries) {
+        std::cout << "  " << entry.name << ": " << entry.stats.sourceVertexCount << " -> "
+                  << entry.stats.vertexCount << " vertices, " << entry.stats.triangleCount << " triangles, "
+                  << (entry.range.indexType == GL_UNSIGNED_SHORT ? "16" : "32") << "-bit indices, ACMR "
+                  << entry.stats.acmrBefore << " -> " << entry.stats.acmrAfter << std::endl;
+    }
+}
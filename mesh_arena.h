@@ -0,0 +1,62 @@
+// mesh_arena.h
+// Shared vertex/index storage for every static mesh in the engine.
+
+#ifndef MESH_ARENA_H
+#define MESH_ARENA_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+#include "mesh_builder.h"
+
+// Attribute locations used by every VAO that reads from the arena.
+const GLuint kMeshAttribPosition = 0;
+const GLuint kMeshAttribNormal = 1;
+
+// Location of one mesh inside the arena buffers.
+struct MeshRange {
+    GLint baseVertex = 0;
+    GLsizei indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_SHORT;
+    GLintptr indexByteOffset = 0;
+
+    const void* indexOffset() const { return reinterpret_cast<const void*>(indexByteOffset); }
+};
+
+struct MeshArenaEntry {
+    std::string name;
+    MeshRange range;
+    MeshOptimizationStats stats;
+};
+
+// Meshes are appended on the CPU and uploaded once into one VBO and one EBO.
+// 16-bit and 32-bit index ranges share the EBO; each range keeps its own type.
+struct MeshArena {
+    GLuint VBO = 0;
+    GLuint EBO = 0;
+    std::vector<PackedVertex> vertices;
+    std::vector<unsigned char> indexBytes;
+    std::vector<MeshArenaEntry> entries;
+    size_t vertexBytes = 0;
+    size_t indexBytesUploaded = 0;
+};
+
+// Optimizes the mesh (weld, Tipsify, fetch order), packs it and appends it.
+// Picks 16-bit indices when the mesh has at most 65536 vertices.
+MeshRange addMeshToArena(MeshArena& arena, const char* name, MeshData mesh);
+
+// Creates the GL buffers from everything added so far and releases the CPU copies.
+void uploadMeshArena(MeshArena& arena);
+
+// Binds the arena VBO/EBO to the currently bound VAO and sets up the packed
+// position and normal attributes.
+void bindMeshArenaAttributes(const MeshArena& arena);
+
+void destroyMeshArena(MeshArena& arena);
+
+// Prints the per-mesh optimization report (vertex counts, index type, ACMR).
+void printMeshArenaReport(const MeshArena& arena);
+
+#endif // MESH_ARENA_H
@@ -0,0 +1,229 @@
+// mesh_batch.cpp
+// Instance packing, the GL 3.3 instanced path and the GL 4.3 indirect path.
+
+#include "mesh_batch.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstddef>
+
+namespace {
+
+const GLuint kCullWorkgroupSize = 64;
+
+void setInstanceAttributes(GLintptr byteOffset) {
+    for (GLuint row = 0; row < 3; ++row) {
+        glVertexAttribPointer(kBatchAttribModelRow0 + row, 4, GL_FLOAT, GL_FALSE, sizeof(MeshBatchInstance),
+                              reinterpret_cast<void*>(byteOffset + offsetof(MeshBatchInstance, modelRows) +
+                                                      row * sizeof(glm::vec4)));
+    }
+    glVertexAttribPointer(kBatchAttribColor, 3, GL_FLOAT, GL_FALSE, sizeof(MeshBatchInstance),
+                          reinterpret_cast<void*>(byteOffset + offsetof(MeshBatchInstance, color)));
+}
+
+void setInstanceIndexSource(GLuint buffer) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glVertexAttribIPointer(kBatchAttribInstanceIndex, 1, GL_UNSIGNED_INT, sizeof(GLuint), reinterpret_cast<void*>(0));
+}
+
+GLuint commandProgram(const MeshBatch& batch, size_t command, ShaderVariantSet& shaders, uint32_t features,
+                      uint32_t commandFeatureMask) {
+    return getShaderVariant(shaders, features | (batch.commandFeatures[command] & commandFeatureMask));
+}
+
+void useProgram(MeshBatch& batch, GLuint program, GLuint& current) {
+    if (program == current)
+        return;
+    glUseProgram(program);
+    current = program;
+    ++batch.lastProgramSwitches;
+}
+
+GLuint indexSize(GLenum indexType) {
+    return indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+}
+
+// Flattens the buckets into batch.packed, fills one command per mesh and makes
+// sure the GPU buffers can hold everything.
+void packBatch(MeshBatch& batch) {
+    batch.packed.clear();
+    batch.commands.resize(batch.meshes.size());
+    for (size_t c = 0; c < batch.meshes.size(); ++c) {
+        const MeshRange& mesh = batch.meshes[c];
+        DrawElementsIndirectCommand& cmd = batch.commands[c];
+        cmd.count = static_cast<GLuint>(mesh.indexCount);
+        cmd.instanceCount = static_cast<GLuint>(batch.buckets[c].size());
+        cmd.firstIndex = static_cast<GLuint>(mesh.indexByteOffset / indexSize(mesh.indexType));
+        cmd.baseVertex = mesh.baseVertex;
+        cmd.baseInstance = static_cast<GLuint>(batch.packed.size());
+        batch.packed.insert(batch.packed.end(), batch.buckets[c].begin(), batch.buckets[c].end());
+    }
+
+    GLsizeiptr count = static_cast<GLsizeiptr>(batch.packed.size());
+    if (count > batch.instanceCapacity) {
+        batch.instanceCapacity = count * 2;
+        std::vector<GLuint> identity(static_cast<size_t>(batch.instanceCapacity));
+        for (size_t i = 0; i < identity.size(); ++i)
+            identity[i] = static_cast<GLuint>(i);
+        glBindBuffer(GL_ARRAY_BUFFER, batch.identityBuffer);
+        glBufferData(GL_ARRAY_BUFFER, identity.size() * sizeof(GLuint), identity.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, batch.visibleBuffer);
+        glBufferData(GL_ARRAY_BUFFER, identity.size() * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, batch.instanceBuffer);
+    // Orphan the previous frame's storage so the driver does not stall on it.
+    glBufferData(GL_ARRAY_BUFFER, batch.instanceCapacity * sizeof(MeshBatchInstance), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(MeshBatchInstance), batch.packed.data());
+}
+
+} // namespace
+
+bool meshBatchSupportsIndirect() {
+    return GLAD_GL_VERSION_4_3 != 0;
+}
+
+uint32_t addMeshBatchCommand(MeshBatch& batch, const MeshRange& mesh, uint32_t features) {
+    batch.meshes.push_back(mesh);
+    batch.commandFeatures.push_back(features);
+    batch.buckets.resize(batch.meshes.size());
+    return static_cast<uint32_t>(batch.meshes.size() - 1);
+}
+
+void setupMeshBatch(MeshBatch& batch, const MeshArena& arena) {
+    glGenBuffers(1, &batch.instanceBuffer);
+    glGenBuffers(1, &batch.identityBuffer);
+    glGenBuffers(1, &batch.visibleBuffer);
+    glGenBuffers(1, &batch.commandBuffer);
+
+    glGenVertexArrays(1, &batch.instancedVAO);
+    glBindVertexArray(batch.instancedVAO);
+    bindMeshArenaAttributes(arena);
+    glBindBuffer(GL_ARRAY_BUFFER, batch.instanceBuffer);
+    setInstanceAttributes(0);
+    for (GLuint location = kBatchAttribModelRow0; location <= kBatchAttribColor; ++location) {
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+
+    glGenVertexArrays(1, &batch.indirectVAO);
+    glBindVertexArray(batch.indirectVAO);
+    bindMeshArenaAttributes(arena);
+    // Instanced attributes honour the command's baseInstance, so this yields
+    // the index of the instance being drawn.
+    setInstanceIndexSource(batch.identityBuffer);
+    glEnableVertexAttribArray(kBatchAttribInstanceIndex);
+    glVertexAttribDivisor(kBatchAttribInstanceIndex, 1);
+    glBindVertexArray(0);
+}
+
+void destroyMeshBatch(MeshBatch& batch) {
+    glDeleteVertexArrays(1, &batch.instancedVAO);
+    glDeleteVertexArrays(1, &batch.indirectVAO);
+    glDeleteBuffers(1, &batch.instanceBuffer);
+    glDeleteBuffers(1, &batch.identityBuffer);
+    glDeleteBuffers(1, &batch.visibleBuffer);
+    glDeleteBuffers(1, &batch.commandBuffer);
+    batch = MeshBatch();
+}
+
+void clearMeshBatch(MeshBatch& batch) {
+    for (std::vector<MeshBatchInstance>& bucket : batch.buckets)
+        bucket.clear();
+}
+
+void pushMeshBatchInstance(MeshBatch& batch, uint32_t command, const glm::mat4& model,
+                           float boundingRadius, const glm::vec3& color) {
+    MeshBatchInstance instance;
+    for (int row = 0; row < 3; ++row)
+        instance.modelRows[row] = glm::vec4(model[0][row], model[1][row], model[2][row], model[3][row]);
+    instance.boundingSphere = glm::vec4(model[3][0], model[3][1], model[3][2], boundingRadius);
+    instance.color = color;
+    instance.commandIndex = command;
+    batch.buckets[command].push_back(instance);
+}
+
+size_t meshBatchInstanceCount(const MeshBatch& batch) {
+    size_t count = 0;
+    for (const std::vector<MeshBatchInstance>& bucket : batch.buckets)
+        count += bucket.size();
+    return count;
+}
+
+void drawMeshBatchInstanced(MeshBatch& batch, ShaderVariantSet& shaders, uint32_t features,
+                            uint32_t commandFeatureMask) {
+    batch.lastDrawCalls = 0;
+    batch.lastProgramSwitches = 0;
+    if (meshBatchInstanceCount(batch) == 0)
+        return;
+    packBatch(batch);
+    glBindVertexArray(batch.instancedVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, batch.instanceBuffer);
+    GLuint current = 0;
+    for (size_t c = 0; c < batch.commands.size(); ++c) {
+        const DrawElementsIndirectCommand& cmd = batch.commands[c];
+        if (cmd.instanceCount == 0)
+            continue;
+        useProgram(batch, commandProgram(batch, c, shaders, features, commandFeatureMask), current);
+        // GL 3.3 has no base instance, so re-point the instance attributes at
+        // this command's slice of the buffer.
+        setInstanceAttributes(static_cast<GLintptr>(cmd.baseInstance * sizeof(MeshBatchInstance)));
+        const MeshRange& mesh = batch.meshes[c];
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, mesh.indexCount, mesh.indexType, mesh.indexOffset(),
+                                          static_cast<GLsizei>(cmd.instanceCount), mesh.baseVertex);
+        ++batch.lastDrawCalls;
+    }
+    glBindVertexArray(0);
+}
+
+void drawMeshBatchIndirect(MeshBatch& batch, ShaderVariantSet& shaders, uint32_t features,
+                           uint32_t commandFeatureMask, GLuint cullProgram, const Frustum& frustum) {
+    batch.lastDrawCalls = 0;
+    batch.lastProgramSwitches = 0;
+    const GLuint instanceCount = static_cast<GLuint>(meshBatchInstanceCount(batch));
+    if (instanceCount == 0)
+        return;
+    packBatch(batch);
+    const bool cull = cullProgram != 0;
+    if (cull) {
+        // The cull shader counts visible instances into each command.
+        for (DrawElementsIndirectCommand& cmd : batch.commands)
+            cmd.instanceCount = 0;
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, batch.commandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, batch.commands.size() * sizeof(DrawElementsIndirectCommand),
+                 batch.commands.data(), GL_STREAM_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kBatchInstanceBinding, batch.instanceBuffer);
+
+    if (cull) {
+        glUseProgram(cullProgram);
+        glUniform4fv(glGetUniformLocation(cullProgram, "uFrustumPlanes"), 6, glm::value_ptr(frustum.planes[0]));
+        glUniform1ui(glGetUniformLocation(cullProgram, "uInstanceCount"), instanceCount);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kBatchCommandBinding, batch.commandBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kBatchVisibleBinding, batch.visibleBuffer);
+        glDispatchCompute((instanceCount + kCullWorkgroupSize - 1) / kCullWorkgroupSize, 1, 1);
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+    }
+
+    glBindVertexArray(batch.indirectVAO);
+    setInstanceIndexSource(cull ? batch.visibleBuffer : batch.identityBuffer);
+    // One call per run of commands sharing an index type and shader variant; the
+    // arena normally holds only 16-bit ranges, so this is usually one call per
+    // variant.
+    GLuint current = 0;
+    size_t runStart = 0;
+    while (runStart < batch.meshes.size()) {
+        GLenum indexType = batch.meshes[runStart].indexType;
+        GLuint program = commandProgram(batch, runStart, shaders, features, commandFeatureMask);
+        size_t runEnd = runStart + 1;
+        while (runEnd < batch.meshes.size() && batch.meshes[runEnd].indexType == indexType &&
+               commandProgram(batch, runEnd, shaders, features, commandFeatureMask) == program)
+            ++runEnd;
+        useProgram(batch, program, current);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, indexType,
+                                    reinterpret_cast<void*>(runStart * sizeof(DrawElementsIndirectCommand)),
+                                    static_cast<GLsizei>(runEnd - runStart), 0);
+        ++batch.lastDrawCalls;
+        runStart = runEnd;
+    }
+    glBindVertexArray(0);
+}
@@ -0,0 +1,101 @@
+// mesh_batch.h
+// Batched submission of arena meshes: one draw command per mesh, instances
+// bucketed per command. Submitted either as one instanced draw per mesh (GL 3.3)
+// or as a single glMultiDrawElementsIndirect with optional GPU frustum culling
+// (GL 4.3).
+
+#ifndef MESH_BATCH_H
+#define MESH_BATCH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "frustum.h"
+#include "mesh_arena.h"
+#include "shader_variants.h"
+
+// Per-instance attribute locations for the instanced path (0/1 are the arena
+// position/normal). The indirect path uses location 2 for the instance index.
+const GLuint kBatchAttribModelRow0 = 2;
+const GLuint kBatchAttribColor = 5;
+const GLuint kBatchAttribInstanceIndex = 2;
+
+// Shader storage bindings used by the indirect path and the cull shader.
+const GLuint kBatchInstanceBinding = 0;
+const GLuint kBatchCommandBinding = 1;
+const GLuint kBatchVisibleBinding = 2;
+
+// Matches the std430 Instance struct in the batch shaders (80 bytes).
+struct MeshBatchInstance {
+    glm::vec4 modelRows[3];    // rows of the affine model matrix
+    glm::vec4 boundingSphere;  // world-space center and radius, for culling
+    glm::vec3 color;
+    uint32_t commandIndex;     // draw command (mesh) this instance belongs to
+};
+
+// Layout defined by GL for indirect indexed draws.
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+enum class MeshBatchPath {
+    Instanced,
+    MultiDrawIndirect
+};
+
+struct MeshBatch {
+    std::vector<MeshRange> meshes;                          // one draw command each
+    std::vector<uint32_t> commandFeatures;                  // shader features specific to each mesh
+    std::vector<std::vector<MeshBatchInstance>> buckets;    // per command, rebuilt every frame
+
+    GLuint instancedVAO = 0;
+    GLuint indirectVAO = 0;
+    GLuint instanceBuffer = 0;
+    GLuint identityBuffer = 0;  // 0..N-1, instance indices when not culling
+    GLuint visibleBuffer = 0;   // written by the cull shader
+    GLuint commandBuffer = 0;
+    GLsizeiptr instanceCapacity = 0;
+
+    std::vector<MeshBatchInstance> packed;
+    std::vector<DrawElementsIndirectCommand> commands;
+    size_t lastDrawCalls = 0;
+    size_t lastProgramSwitches = 0;
+};
+
+// True when the current context exposes GL 4.3 (indirect draws, SSBOs, compute).
+bool meshBatchSupportsIndirect();
+
+// Registers a mesh and returns its command index. Call before setupMeshBatch.
+// features are shader variant bits that only apply to this mesh's bucket.
+uint32_t addMeshBatchCommand(MeshBatch& batch, const MeshRange& mesh, uint32_t features = 0);
+
+// Creates the VAOs and buffers over the uploaded arena.
+void setupMeshBatch(MeshBatch& batch, const MeshArena& arena);
+void destroyMeshBatch(MeshBatch& batch);
+
+void clearMeshBatch(MeshBatch& batch);
+void pushMeshBatchInstance(MeshBatch& batch, uint32_t command, const glm::mat4& model,
+                           float boundingRadius, const glm::vec3& color);
+size_t meshBatchInstanceCount(const MeshBatch& batch);
+
+// Each bucket is drawn with the variant for features | (its command features
+// & commandFeatureMask); the caller keeps the Frame uniform block up to date.
+
+// One instanced draw per non-empty command.
+void drawMeshBatchInstanced(MeshBatch& batch, ShaderVariantSet& shaders, uint32_t features,
+                            uint32_t commandFeatureMask);
+
+// Uploads instances and commands, optionally culls on the GPU with cullProgram
+// (pass 0 to skip), and submits with one glMultiDrawElementsIndirect per run of
+// commands sharing an index type and variant. Requires meshBatchSupportsIndirect().
+void drawMeshBatchIndirect(MeshBatch& batch, ShaderVariantSet& shaders, uint32_t features,
+                           uint32_t commandFeatureMask, GLuint cullProgram, const Frustum& frustum);
+
+#endif // MESH_BATCH_H
@@ -0,0 +1,268 @@
+// mesh_builder.cpp
+// Vertex welding, Tipsify triangle reordering, ACMR measurement and packing.
+
+#include "mesh_builder.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+struct VertexKey {
+    float data[6];
+    bool operator==(const VertexKey& other) const {
+        return std::memcmp(data, other.data, sizeof(data)) == 0;
+    }
+};
+
+struct VertexKeyHash {
+    size_t operator()(const VertexKey& key) const {
+        // FNV-1a over the raw bits; welding only merges exact duplicates.
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(key.data);
+        size_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < sizeof(key.data); ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+};
+
+int16_t toSnorm16(float v) {
+    v = v < -1.0f ? -1.0f : (v > 1.0f ? 1.0f : v);
+    return static_cast<int16_t>(std::lround(v * 32767.0f));
+}
+
+float signNotZero(float v) {
+    return v >= 0.0f ? 1.0f : -1.0f;
+}
+
+// Tipsify helper: next fanning vertex once the current fan is exhausted.
+int skipDeadEnd(std::vector<uint32_t>& deadEnds, const std::vector<uint32_t>& liveTriangles,
+                size_t& cursor, size_t vertexCount) {
+    while (!deadEnds.empty()) {
+        uint32_t v = deadEnds.back();
+        deadEnds.pop_back();
+        if (liveTriangles[v] > 0)
+            return static_cast<int>(v);
+    }
+    while (cursor < vertexCount) {
+        if (liveTriangles[cursor] > 0)
+            return static_cast<int>(cursor);
+        ++cursor;
+    }
+    return -1;
+}
+
+} // namespace
+
+MeshData meshFromTriangleSoup(const float* positions, size_t vertexCount) {
+    MeshData mesh;
+    mesh.positions.reserve(vertexCount);
+    mesh.normals.reserve(vertexCount);
+    mesh.indices.reserve(vertexCount);
+    glm::vec3 centroid(0.0f);
+    for (size_t i = 0; i < vertexCount; ++i)
+        centroid += glm::vec3(positions[i * 3 + 0], positions[i * 3 + 1], positions[i * 3 + 2]);
+    centroid /= static_cast<float>(vertexCount > 0 ? vertexCount : 1);
+    for (size_t i = 0; i + 2 < vertexCount; i += 3) {
+        glm::vec3 p0(positions[i * 3 + 0], positions[i * 3 + 1], positions[i * 3 + 2]);
+        glm::vec3 p1(positions[i * 3 + 3], positions[i * 3 + 4], positions[i * 3 + 5]);
+        glm::vec3 p2(positions[i * 3 + 6], positions[i * 3 + 7], positions[i * 3 + 8]);
+        glm::vec3 normal = glm::normalize(glm::cross(p1 - p0, p2 - p0));
+        // The source winding is not consistent, so orient normals outwards.
+        if (glm::dot(normal, (p0 + p1 + p2) * (1.0f / 3.0f) - centroid) < 0.0f)
+            normal = normal * -1.0f;
+        const glm::vec3 corners[3] = { p0, p1, p2 };
+        for (const glm::vec3& p : corners) {
+            mesh.indices.push_back(static_cast<uint32_t>(mesh.positions.size()));
+            mesh.positions.push_back(p);
+            mesh.normals.push_back(normal);
+        }
+    }
+    return mesh;
+}
+
+void weldVertices(MeshData& mesh) {
+    const bool hasNormals = !mesh.normals.empty();
+    std::unordered_map<VertexKey, uint32_t, VertexKeyHash> unique;
+    unique.reserve(mesh.positions.size());
+    std::vector<uint32_t> remap(mesh.positions.size());
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    positions.reserve(mesh.positions.size());
+    if (hasNormals)
+        normals.reserve(mesh.normals.size());
+    for (size_t i = 0; i < mesh.positions.size(); ++i) {
+        VertexKey key;
+        glm::vec3 n = hasNormals ? mesh.normals[i] : glm::vec3(0.0f);
+        const float values[6] = { mesh.positions[i].x, mesh.positions[i].y, mesh.positions[i].z, n.x, n.y, n.z };
+        // Adding +0 folds -0 into +0 so the bitwise compare treats them as equal.
+        for (int k = 0; k < 6; ++k)
+            key.data[k] = values[k] + 0.0f;
+        auto inserted = unique.emplace(key, static_cast<uint32_t>(positions.size()));
+        if (inserted.second) {
+            positions.push_back(mesh.positions[i]);
+            if (hasNormals)
+                normals.push_back(n);
+        }
+        remap[i] = inserted.first->second;
+    }
+    for (uint32_t& index : mesh.indices)
+        index = remap[index];
+    mesh.positions.swap(positions);
+    mesh.normals.swap(normals);
+}
+
+float computeAcmr(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned int cacheSize) {
+    if (indices.empty())
+        return 0.0f;
+    // A vertex is still cached if fewer than cacheSize misses happened since it
+    // was last loaded (FIFO replacement).
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+    size_t misses = 0;
+    for (uint32_t index : indices) {
+        if (time - cacheTime[index] > cacheSize) {
+            cacheTime[index] = time++;
+            ++misses;
+        }
+    }
+    return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, unsigned int cacheSize) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+    // Vertex -> triangle adjacency in CSR form.
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (uint32_t index : indices)
+        ++liveTriangles[index];
+    std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+        adjacencyOffset[v + 1] = adjacencyOffset[v] + liveTriangles[v];
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i)
+        adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    deadEnds.reserve(indices.size());
+    candidates.reserve(64);
+    output.reserve(indices.size());
+    uint32_t time = cacheSize + 1;
+    size_t cursor = 0;
+    int fanning = skipDeadEnd(deadEnds, liveTriangles, cursor, vertexCount);
+    while (fanning >= 0) {
+        candidates.clear();
+        for (uint32_t a = adjacencyOffset[fanning]; a < adjacencyOffset[fanning + 1]; ++a) {
+            uint32_t triangle = adjacency[a];
+            if (emitted[triangle])
+                continue;
+            for (int corner = 0; corner < 3; ++corner) {
+                uint32_t v = indices[triangle * 3 + corner];
+                output.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                --liveTriangles[v];
+                if (time - cacheTime[v] > cacheSize)
+                    cacheTime[v] = time++;
+            }
+            emitted[triangle] = 1;
+        }
+        // Prefer the candidate that stays in cache longest while its remaining
+        // triangles are emitted.
+        int best = -1;
+        int bestPriority = -1;
+        for (uint32_t v : candidates) {
+            if (liveTriangles[v] == 0)
+                continue;
+            int priority = 0;
+            if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+                priority = static_cast<int>(time - cacheTime[v]);
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                best = static_cast<int>(v);
+            }
+        }
+        fanning = best >= 0 ? best : skipDeadEnd(deadEnds, liveTriangles, cursor, vertexCount);
+    }
+    indices.swap(output);
+}
+
+void optimizeVertexFetch(MeshData& mesh) {
+    const uint32_t unused = 0xffffffffu;
+    std::vector<uint32_t> remap(mesh.positions.size(), unused);
+    uint32_t next = 0;
+    for (uint32_t& index : mesh.indices) {
+        if (remap[index] == unused)
+            remap[index] = next++;
+        index = remap[index];
+    }
+    const bool hasNormals = !mesh.normals.empty();
+    std::vector<glm::vec3> positions(next);
+    std::vector<glm::vec3> normals(hasNormals ? next : 0);
+    for (size_t v = 0; v < remap.size(); ++v) {
+        if (remap[v] == unused)
+            continue;
+        positions[remap[v]] = mesh.positions[v];
+        if (hasNormals)
+            normals[remap[v]] = mesh.normals[v];
+    }
+    mesh.positions.swap(positions);
+    mesh.normals.swap(normals);
+}
+
+MeshOptimizationStats optimizeMesh(MeshData& mesh) {
+    MeshOptimizationStats stats;
+    stats.sourceVertexCount = mesh.positions.size();
+    stats.triangleCount = mesh.indices.size() / 3;
+    stats.acmrBefore = computeAcmr(mesh.indices, mesh.positions.size(), kVertexCacheSize);
+    weldVertices(mesh);
+    optimizeVertexCache(mesh.indices, mesh.positions.size(), kVertexCacheSize);
+    optimizeVertexFetch(mesh);
+    stats.vertexCount = mesh.positions.size();
+    stats.acmrAfter = computeAcmr(mesh.indices, mesh.positions.size(), kVertexCacheSize);
+    return stats;
+}
+
+void encodeOctahedralNormal(const glm::vec3& n, int16_t out[2]) {
+    float invL1 = 1.0f / (std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z));
+    float x = n.x * invL1;
+    float y = n.y * invL1;
+    if (n.z < 0.0f) {
+        float foldedX = (1.0f - std::fabs(y)) * signNotZero(x);
+        float foldedY = (1.0f - std::fabs(x)) * signNotZero(y);
+        x = foldedX;
+        y = foldedY;
+    }
+    out[0] = toSnorm16(x);
+    out[1] = toSnorm16(y);
+}
+
+std::vector<PackedVertex> packVertices(const MeshData& mesh) {
+    std::vector<PackedVertex> packed(mesh.positions.size());
+    const uint16_t halfOne = glm::packHalf1x16(1.0f);
+    for (size_t i = 0; i < mesh.positions.size(); ++i) {
+        PackedVertex& v = packed[i];
+        v.position[0] = glm::packHalf1x16(mesh.positions[i].x);
+        v.position[1] = glm::packHalf1x16(mesh.positions[i].y);
+        v.position[2] = glm::packHalf1x16(mesh.positions[i].z);
+        v.position[3] = halfOne;
+        if (mesh.normals.empty()) {
+            v.normal[0] = 0;
+            v.normal[1] = 0;
+        } else {
+            encodeOctahedralNormal(mesh.normals[i], v.normal);
+        }
+    }
+    return packed;
+}
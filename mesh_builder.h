@@ -0,0 +1,69 @@
+// mesh_builder.h
+// CPU-side mesh preparation: vertex welding, post-transform vertex cache
+// optimization (Tipsify), fetch reordering and packed vertex encoding.
+
+#ifndef MESH_BUILDER_H
+#define MESH_BUILDER_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Post-transform cache size assumed for optimization and ACMR reporting.
+const unsigned int kVertexCacheSize = 16;
+
+// Unpacked mesh as produced by generators. Normals are optional (empty or one
+// per position).
+struct MeshData {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<uint32_t> indices;
+};
+
+// Compact GPU vertex: half-float position (w = 1) and an octahedral normal in
+// two snorm16 components. 12 bytes instead of 24 for two float3 attributes.
+struct PackedVertex {
+    uint16_t position[4];
+    int16_t normal[2];
+};
+
+// Before/after numbers recorded for each mesh that goes through optimizeMesh.
+struct MeshOptimizationStats {
+    size_t sourceVertexCount = 0;
+    size_t vertexCount = 0;
+    size_t triangleCount = 0;
+    float acmrBefore = 0.0f;
+    float acmrAfter = 0.0f;
+};
+
+// Builds an indexed mesh from a flat triangle list of float3 positions, with a
+// flat face normal per triangle pointing away from the centroid (the soup is
+// expected to be a closed convex shape).
+MeshData meshFromTriangleSoup(const float* positions, size_t vertexCount);
+
+// Merges bitwise-identical vertices (position and normal) and remaps indices.
+void weldVertices(MeshData& mesh);
+
+// Average cache miss ratio (transformed vertices per triangle) of an index
+// buffer on a FIFO post-transform cache of the given size.
+float computeAcmr(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned int cacheSize);
+
+// Reorders triangles for post-transform cache reuse (Sander et al., "Fast
+// Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007).
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, unsigned int cacheSize);
+
+// Renumbers vertices in order of first use so vertex fetches walk memory forward.
+void optimizeVertexFetch(MeshData& mesh);
+
+// Weld, cache-optimize and fetch-optimize in one pass, recording ACMR before
+// and after.
+MeshOptimizationStats optimizeMesh(MeshData& mesh);
+
+// Octahedral normal encoding into two snorm16 values.
+void encodeOctahedralNormal(const glm::vec3& n, int16_t out[2]);
+
+// Packs positions to half floats and normals to octahedral snorm16.
+std::vector<PackedVertex> packVertices(const MeshData& mesh);
+
+#endif // MESH_BUILDER_H
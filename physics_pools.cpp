@@ -0,0 +1,61 @@
+// physics_pools.cpp
+// Construction info, the counting dispatcher and pool pre-warming.
+
+#include "physics_pools.h"
+
+#include <LinearMath/btPoolAllocator.h>
+
+#include <algorithm>
+
+btDefaultCollisionConstructionInfo makeCollisionConstructionInfo(const PhysicsPoolSettings& settings) {
+    btDefaultCollisionConstructionInfo info;
+    info.m_defaultMaxPersistentManifoldPoolSize = std::max(settings.manifoldPoolSize, 1);
+    info.m_defaultMaxCollisionAlgorithmPoolSize = std::max(settings.collisionAlgorithmPoolSize, 1);
+    return info;
+}
+
+PooledCollisionDispatcher::PooledCollisionDispatcher(btDefaultCollisionConfiguration* configuration, int grainSize)
+    : btCollisionDispatcherMt(configuration, grainSize), manifoldOverflowCount(0), collisionAlgorithmOverflowCount(0) {}
+
+btPersistentManifold* PooledCollisionDispatcher::getNewManifold(const btCollisionObject* body0,
+                                                                const btCollisionObject* body1) {
+    btPersistentManifold* manifold = btCollisionDispatcherMt::getNewManifold(body0, body1);
+    if (manifold && !m_persistentManifoldPoolAllocator->validPtr(manifold))
+        ++manifoldOverflowCount;
+    return manifold;
+}
+
+void* PooledCollisionDispatcher::allocateCollisionAlgorithm(int size) {
+    void* algorithm = btCollisionDispatcherMt::allocateCollisionAlgorithm(size);
+    if (algorithm && !m_collisionAlgorithmPoolAllocator->validPtr(algorithm))
+        ++collisionAlgorithmOverflowCount;
+    return algorithm;
+}
+
+void PooledCollisionDispatcher::reserveManifolds(int count) {
+    m_manifoldsPtr.reserve(count);
+    // Each thread's list of the manifolds it made in one narrowphase pass; a
+    // share of the pool covers everything but a burst of new contacts.
+    for (int i = 0; i < m_batchManifoldsPtr.size(); ++i)
+        m_batchManifoldsPtr[i].reserve(count / m_batchManifoldsPtr.size() + 1);
+}
+
+void prewarmPhysicsPools(btDefaultCollisionConfiguration& configuration, PooledCollisionDispatcher& dispatcher) {
+    // The pools themselves are single blocks that were written through (to
+    // link their free lists) when the configuration was made, so they are
+    // already resident. What grows on the first steps is the bookkeeping.
+    dispatcher.reserveManifolds(configuration.getPersistentManifoldPool()->getMaxCount());
+}
+
+PhysicsPoolStats getPhysicsPoolStats(btDefaultCollisionConfiguration& configuration,
+                                     const PooledCollisionDispatcher& dispatcher) {
+    PhysicsPoolStats stats;
+    const btPoolAllocator* manifolds = configuration.getPersistentManifoldPool();
+    const btPoolAllocator* algorithms = configuration.getCollisionAlgorithmPool();
+    stats.manifoldsUsed = manifolds->getUsedCount();
+    stats.manifoldCapacity = manifolds->getMaxCount();
+    stats.collisionAlgorithmsUsed = algorithms->getUsedCount();
+    stats.collisionAlgorithmCapacity = algorithms->getMaxCount();
+    stats.overflows = dispatcher.manifoldOverflows() + dispatcher.collisionAlgorithmOverflows();
+    return stats;
+}
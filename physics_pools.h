@@ -0,0 +1,62 @@
+// physics_pools.h
+// Sizing and telemetry for Bullet's contact pools. The collision
+// configuration preallocates one pool of persistent manifolds and one of
+// collision algorithms; once either is full Bullet quietly takes new ones from
+// the heap, mid-step. Here the pool sizes come from the engine settings, the
+// dispatcher's manifold lists are sized for full pools at world creation, and
+// the dispatcher counts every allocation that missed its pool.
+
+#ifndef PHYSICS_POOLS_H
+#define PHYSICS_POOLS_H
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+struct PhysicsPoolSettings {
+    int manifoldPoolSize = 4096;            // persistent manifolds, about one per touching pair
+    int collisionAlgorithmPoolSize = 4096;  // algorithms, one per overlapping pair (plus compound children)
+    bool prewarm = true;
+};
+
+btDefaultCollisionConstructionInfo makeCollisionConstructionInfo(const PhysicsPoolSettings& settings);
+
+// The multithreaded dispatcher, counting manifolds and algorithms that did not
+// fit in their pools. Counts are atomic: narrowphase jobs allocate in parallel.
+class PooledCollisionDispatcher : public btCollisionDispatcherMt {
+public:
+    PooledCollisionDispatcher(btDefaultCollisionConfiguration* configuration, int grainSize);
+
+    btPersistentManifold* getNewManifold(const btCollisionObject* body0, const btCollisionObject* body1) override;
+    void* allocateCollisionAlgorithm(int size) override;
+
+    // Reserves the manifold lists for count manifolds, so adding manifolds
+    // does not regrow them mid-step.
+    void reserveManifolds(int count);
+
+    uint64_t manifoldOverflows() const { return manifoldOverflowCount.load(); }
+    uint64_t collisionAlgorithmOverflows() const { return collisionAlgorithmOverflowCount.load(); }
+
+private:
+    std::atomic<uint64_t> manifoldOverflowCount;
+    std::atomic<uint64_t> collisionAlgorithmOverflowCount;
+};
+
+// Sizes the dispatcher's manifold lists for the configuration's pool.
+void prewarmPhysicsPools(btDefaultCollisionConfiguration& configuration, PooledCollisionDispatcher& dispatcher);
+
+struct PhysicsPoolStats {
+    int manifoldsUsed = 0;
+    int manifoldCapacity = 0;
+    int collisionAlgorithmsUsed = 0;
+    int collisionAlgorithmCapacity = 0;
+    uint64_t overflows = 0;     // manifolds and algorithms from the heap, all time
+};
+
+PhysicsPoolStats getPhysicsPoolStats(btDefaultCollisionConfiguration& configuration,
+                                     const PooledCollisionDispatcher& dispatcher);
+
+#endif // PHYSICS_POOLS_H
@@ -0,0 +1,78 @@
+// render_queue.cpp
+// Sort key packing and the radix sort.
+
+#include "render_queue.h"
+
+#include <utility>
+
+namespace {
+
+uint64_t fieldBits(uint32_t value, int bits) {
+    return static_cast<uint64_t>(value) & ((static_cast<uint64_t>(1) << bits) - 1);
+}
+
+uint32_t quantizeDepth(float depth) {
+    depth = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+    const uint32_t maxDepth = (1u << kSortKeyDepthBits) - 1;
+    return static_cast<uint32_t>(depth * static_cast<float>(maxDepth));
+}
+
+} // namespace
+
+uint64_t makeSortKey(RenderPass pass, uint32_t shader, uint32_t mesh, uint32_t material, float depth) {
+    const uint64_t passBits = fieldBits(static_cast<uint32_t>(pass), 4) << 60;
+    const uint64_t state = (fieldBits(shader, kSortKeyShaderBits) << (kSortKeyMeshBits + kSortKeyMaterialBits)) |
+                           (fieldBits(mesh, kSortKeyMeshBits) << kSortKeyMaterialBits) |
+                           fieldBits(material, kSortKeyMaterialBits);
+    const uint32_t quantized = quantizeDepth(depth);
+    if (pass == RenderPass::Transparent) {
+        // Blending needs back-to-front order, so depth outranks state.
+        const uint64_t farFirst = fieldBits(((1u << kSortKeyDepthBits) - 1) - quantized, kSortKeyDepthBits);
+        return passBits | (farFirst << 36) | state;
+    }
+    return passBits | (state << kSortKeyDepthBits) | quantized;
+}
+
+RenderPass sortKeyPass(uint64_t key) {
+    return static_cast<RenderPass>(key >> 60);
+}
+
+void clearRenderQueue(RenderQueue& queue) {
+    queue.items.clear();
+}
+
+void pushRenderItem(RenderQueue& queue, uint64_t key, uint32_t payload) {
+    RenderQueueItem item;
+    item.key = key;
+    item.payload = payload;
+    queue.items.push_back(item);
+}
+
+void sortRenderQueue(RenderQueue& queue) {
+    queue.lastSortPasses = 0;
+    const size_t count = queue.items.size();
+    if (count < 2)
+        return;
+    queue.scratch.resize(count);
+    std::vector<RenderQueueItem>* source = &queue.items;
+    std::vector<RenderQueueItem>* target = &queue.scratch;
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t histogram[256] = {};
+        for (const RenderQueueItem& item : *source)
+            ++histogram[(item.key >> shift) & 0xff];
+        if (histogram[((*source)[0].key >> shift) & 0xff] == count)
+            continue; // every key shares this byte
+        size_t offset = 0;
+        for (size_t& bucket : histogram) {
+            size_t bucketCount = bucket;
+            bucket = offset;
+            offset += bucketCount;
+        }
+        for (const RenderQueueItem& item : *source)
+            (*target)[histogram[(item.key >> shift) & 0xff]++] = item;
+        std::swap(source, target);
+        ++queue.lastSortPasses;
+    }
+    if (source != &queue.items)
+        queue.items.swap(queue.scratch);
+}
@@ -0,0 +1,51 @@
+// render_queue.h
+// Per-frame list of draw items ordered by a 64-bit sort key, radix-sorted so
+// that submission walks shaders, meshes and materials in runs and each piece
+// of state is bound once.
+//
+// Key layout, most significant bits first:
+//   opaque/debug:  pass (4) | shader (8) | mesh (12) | material (16) | depth (24), near first
+//   transparent:   pass (4) | depth (24), far first | shader (8) | mesh (12) | material (16)
+
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class RenderPass : uint32_t {
+    Opaque = 0,
+    Transparent = 1,
+    Debug = 2
+};
+
+const int kSortKeyShaderBits = 8;
+const int kSortKeyMeshBits = 12;
+const int kSortKeyMaterialBits = 16;
+const int kSortKeyDepthBits = 24;
+
+// depth is the normalized view distance in [0, 1] (clamped).
+uint64_t makeSortKey(RenderPass pass, uint32_t shader, uint32_t mesh, uint32_t material, float depth);
+
+RenderPass sortKeyPass(uint64_t key);
+
+struct RenderQueueItem {
+    uint64_t key;
+    uint32_t payload;   // index into the caller's per-frame draw data
+};
+
+struct RenderQueue {
+    std::vector<RenderQueueItem> items;
+    std::vector<RenderQueueItem> scratch;
+    int lastSortPasses = 0;     // radix passes that actually moved data
+};
+
+void clearRenderQueue(RenderQueue& queue);
+void pushRenderItem(RenderQueue& queue, uint64_t key, uint32_t payload);
+
+// Stable LSD radix sort on the key, 8 bits per pass. Passes whose byte is the
+// same for every item are skipped.
+void sortRenderQueue(RenderQueue& queue);
+
+#endif // RENDER_QUEUE_H
@@ -0,0 +1,57 @@
+// render_target.cpp
+// Framebuffer object creation and readback.
+
+#include "render_target.h"
+
+#include <cstring>
+#include <iostream>
+
+bool createRenderTarget(RenderTarget& target, int width, int height) {
+    target.width = width;
+    target.height = height;
+    glGenRenderbuffers(1, &target.colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, target.colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &target.depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, target.depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &target.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, target.depthBuffer);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Render target " << width << "x" << height << " is incomplete (0x" << std::hex << status
+                  << std::dec << ")" << std::endl;
+        destroyRenderTarget(target);
+        return false;
+    }
+    return true;
+}
+
+void destroyRenderTarget(RenderTarget& target) {
+    glDeleteFramebuffers(1, &target.framebuffer);
+    glDeleteRenderbuffers(1, &target.colorBuffer);
+    glDeleteRenderbuffers(1, &target.depthBuffer);
+    target = RenderTarget();
+}
+
+void bindRenderTarget(const RenderTarget& target) {
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    glViewport(0, 0, target.width, target.height);
+}
+
+void readRenderTarget(const RenderTarget& target, std::vector<unsigned char>& rgb) {
+    const size_t rowBytes = static_cast<size_t>(target.width) * 3;
+    std::vector<unsigned char> bottomUp(rowBytes * target.height);
+    rgb.resize(bottomUp.size());
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, target.framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, target.width, target.height, GL_RGB, GL_UNSIGNED_BYTE, bottomUp.data());
+    // GL rows start at the bottom; image files start at the top.
+    for (int y = 0; y < target.height; ++y)
+        std::memcpy(&rgb[y * rowBytes], &bottomUp[(target.height - 1 - y) * rowBytes], rowBytes);
+}
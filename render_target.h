@@ -0,0 +1,30 @@
+// render_target.h
+// Offscreen framebuffer (RGBA8 color + depth renderbuffers) and synchronous
+// readback, used when there is no default framebuffer to draw into.
+
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+struct RenderTarget {
+    GLuint framebuffer = 0;
+    GLuint colorBuffer = 0;
+    GLuint depthBuffer = 0;
+    int width = 0;
+    int height = 0;
+};
+
+bool createRenderTarget(RenderTarget& target, int width, int height);
+void destroyRenderTarget(RenderTarget& target);
+
+// Binds the target for drawing and sets the viewport to cover it.
+void bindRenderTarget(const RenderTarget& target);
+
+// Reads the color buffer as tightly packed RGB rows, top row first. Stalls
+// until rendering has finished.
+void readRenderTarget(const RenderTarget& target, std::vector<unsigned char>& rgb);
+
+#endif // RENDER_TARGET_H
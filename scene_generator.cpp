@@ -0,0 +1,93 @@
+// scene_generator.cpp
+// Placement patterns for the initial scene.
+
+#include "scene_generator.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace {
+
+// Bodies per side of a pile layer.
+const int kPileSide = 3;
+
+const char* const kScenePatternNames[] = {"rows", "grid", "pile", "random"};
+
+// Spreads the spheres evenly through count slots: slot i holds a sphere when
+// the running share of spheres passes a whole number there.
+bool sphereSlot(int slot, int count, int spheres) {
+    return static_cast<int64_t>(slot + 1) * spheres / count > static_cast<int64_t>(slot) * spheres / count;
+}
+
+// Offset of cell index from the centre of side cells.
+float centred(int index, int side, float spacing) {
+    return (static_cast<float>(index) - 0.5f * static_cast<float>(side - 1)) * spacing;
+}
+
+// mt19937's output is fixed by the standard; the distributions are not.
+float unitRandom(std::mt19937& random) {
+    return static_cast<float>(random() / 4294967296.0);
+}
+
+} // namespace
+
+void generateScene(const SceneSettings& settings, std::vector<ScenePlacement>& placements) {
+    placements.clear();
+    const int boxes = settings.boxes > 0 ? settings.boxes : 0;
+    const int spheres = settings.spheres > 0 ? settings.spheres : 0;
+    const int count = boxes + spheres;
+    if (count == 0)
+        return;
+    placements.resize(count);
+    const float spacing = settings.spacing;
+    if (settings.pattern == ScenePattern::Rows) {
+        for (int i = 0; i < boxes; ++i)
+            placements[i].position = glm::vec3(centred(i, boxes, spacing), settings.height, 0.0f);
+        for (int i = 0; i < spheres; ++i) {
+            ScenePlacement& placement = placements[boxes + i];
+            placement.sphere = true;
+            placement.position = glm::vec3(centred(i, spheres, spacing), settings.height + 1.2f * spacing, 1.2f * spacing);
+        }
+        return;
+    }
+    const int side = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(count))));
+    std::mt19937 random(settings.seed);
+    for (int i = 0; i < count; ++i) {
+        ScenePlacement& placement = placements[i];
+        placement.sphere = sphereSlot(i, count, spheres);
+        if (settings.pattern == ScenePattern::Grid) {
+            placement.position = glm::vec3(centred(i % side, side, spacing), settings.height,
+                                           centred(i / side, side, spacing));
+        } else if (settings.pattern == ScenePattern::Pile) {
+            // Every other layer sits half a cell over, so the pile settles rather than standing.
+            const int layer = i / (kPileSide * kPileSide);
+            const int cell = i % (kPileSide * kPileSide);
+            const float shift = (layer % 2) ? 0.5f * spacing : 0.0f;
+            placement.position = glm::vec3(centred(cell % kPileSide, kPileSide, spacing) + shift,
+                                           settings.height + static_cast<float>(layer) * spacing,
+                                           centred(cell / kPileSide, kPileSide, spacing) + shift);
+        } else {
+            // A cube as wide as the grid would be, starting at the base height.
+            const float width = static_cast<float>(side) * spacing;
+            const float x = (unitRandom(random) - 0.5f) * width;
+            const float y = settings.height + unitRandom(random) * width;
+            const float z = (unitRandom(random) - 0.5f) * width;
+            placement.position = glm::vec3(x, y, z);
+        }
+    }
+}
+
+const char* scenePatternName(ScenePattern pattern) {
+    return kScenePatternNames[static_cast<int>(pattern)];
+}
+
+bool scenePatternFromName(const char* name, ScenePattern& pattern) {
+    for (size_t i = 0; i < sizeof(kScenePatternNames) / sizeof(kScenePatternNames[0]); ++i) {
+        if (std::strcmp(name, kScenePatternNames[i]) == 0) {
+            pattern = static_cast<ScenePattern>(i);
+            return true;
+        }
+    }
+    return false;
+}
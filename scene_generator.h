@@ -0,0 +1,45 @@
+// scene_generator.h
+// Placements of the scene's initial bodies: how many boxes and spheres, in
+// which pattern, how far apart. Placements are computed from the settings
+// alone, the random pattern from a seeded generator whose output the standard
+// fixes, so a scene comes out the same on every run and platform.
+
+#ifndef SCENE_GENERATOR_H
+#define SCENE_GENERATOR_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+enum class ScenePattern {
+    Rows,       // a row of boxes and, behind and above it, a row of spheres
+    Grid,       // one layer on a square grid
+    Pile,       // stacked layers on a narrow square footprint
+    Random      // scattered through a volume above the ground
+};
+
+struct SceneSettings {
+    int boxes = 5;
+    int spheres = 5;
+    ScenePattern pattern = ScenePattern::Rows;
+    float spacing = 2.5f;           // between neighbouring bodies
+    float height = 5.0f;            // of the lowest bodies
+    float boxHalfExtent = 1.0f;
+    float sphereRadius = 0.5f;
+    uint32_t seed = 1;              // random pattern only
+};
+
+struct ScenePlacement {
+    bool sphere = false;
+    glm::vec3 position;
+};
+
+// Fills placements (cleared first). Apart from the rows pattern, boxes and
+// spheres are interleaved evenly through the placements.
+void generateScene(const SceneSettings& settings, std::vector<ScenePlacement>& placements);
+
+const char* scenePatternName(ScenePattern pattern);
+bool scenePatternFromName(const char* name, ScenePattern& pattern);
+
+#endif // SCENE_GENERATOR_H
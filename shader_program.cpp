@@ -0,0 +1,210 @@
+// shader_program.cpp
+// Program creation and the glGetProgramBinary/glProgramBinary disk cache.
+
+#include "shader_program.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+namespace {
+
+const uint32_t kCacheMagic = 0x50475342; // "BSGP"
+const uint32_t kCacheVersion = 1;
+
+struct CacheFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t binaryFormat;
+    uint32_t binaryLength;
+};
+
+ShaderCacheStats stats;
+std::string cacheDirectory;
+std::string driverSignature;
+
+uint64_t fnv1a(uint64_t hash, const char* data, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string cacheKey(const GLenum* types, const char* const* sources, int count) {
+    uint64_t hash = 14695981039346656037ull;
+    hash = fnv1a(hash, driverSignature.data(), driverSignature.size() + 1);
+    for (int i = 0; i < count; ++i) {
+        hash = fnv1a(hash, reinterpret_cast<const char*>(&types[i]), sizeof(GLenum));
+        hash = fnv1a(hash, sources[i], std::char_traits<char>::length(sources[i]) + 1);
+    }
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+    return cacheDirectory + "/" + name + ".bin";
+}
+
+bool linkSucceeded(GLuint program, bool report) {
+    GLint status;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE && report) {
+        char buffer[512];
+        glGetProgramInfoLog(program, 512, nullptr, buffer);
+        std::cerr << "Program Linking Error: " << buffer << std::endl;
+    }
+    return status == GL_TRUE;
+}
+
+bool loadCachedProgram(GLuint program, const std::string& path) {
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file)
+        return false;
+    CacheFileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        return false;
+    if (header.magic != kCacheMagic || header.version != kCacheVersion || header.binaryLength == 0)
+        return false;
+    std::vector<char> binary(header.binaryLength);
+    if (!file.read(binary.data(), static_cast<std::streamsize>(binary.size())))
+        return false;
+    glProgramBinary(program, header.binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+    // A stale or foreign binary simply fails to link; the caller recompiles.
+    return linkSucceeded(program, false);
+}
+
+void storeProgram(GLuint program, const std::string& path) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+    std::vector<char> binary(static_cast<size_t>(length));
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+    CacheFileHeader header = { kCacheMagic, kCacheVersion, format, static_cast<uint32_t>(length) };
+    std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!file)
+        return;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+    if (file)
+        ++stats.cacheWrites;
+}
+
+GLuint createProgram(const GLenum* types, const char* const* sources, int count) {
+    auto start = std::chrono::steady_clock::now();
+    GLuint program = glCreateProgram();
+    std::string path;
+    bool fromCache = false;
+    if (stats.enabled) {
+        path = cacheKey(types, sources, count);
+        fromCache = loadCachedProgram(program, path);
+        if (!fromCache) {
+            // A failed glProgramBinary leaves the program unusable for linking.
+            glDeleteProgram(program);
+            program = glCreateProgram();
+        }
+    }
+    if (fromCache) {
+        ++stats.programsFromCache;
+    } else {
+        std::vector<GLuint> shaders;
+        for (int i = 0; i < count; ++i) {
+            GLuint shader = compileShader(types[i], sources[i]);
+            glAttachShader(program, shader);
+            shaders.push_back(shader);
+        }
+        if (stats.enabled)
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(program);
+        bool linked = linkSucceeded(program, true);
+        for (GLuint shader : shaders) {
+            glDetachShader(program, shader);
+            glDeleteShader(shader);
+        }
+        ++stats.programsCompiled;
+        if (linked && stats.enabled)
+            storeProgram(program, path);
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    stats.totalMilliseconds += elapsed.count();
+    return program;
+}
+
+bool makeDirectory(const std::string& directory) {
+#ifdef _WIN32
+    if (_mkdir(directory.c_str()) == 0)
+        return true;
+#else
+    if (mkdir(directory.c_str(), 0755) == 0)
+        return true;
+#endif
+    return errno == EEXIST;
+}
+
+} // namespace
+
+void initShaderProgramCache(const std::string& directory) {
+    stats.enabled = false;
+    GLint formats = 0;
+    // glProgramBinary is core in 4.1; older contexts just compile every time.
+    if (GLAD_GL_VERSION_4_1)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats <= 0) {
+        std::cout << "Shader cache: program binaries not supported by this driver" << std::endl;
+        return;
+    }
+    if (!makeDirectory(directory)) {
+        std::cerr << "Shader cache: cannot create " << directory << std::endl;
+        return;
+    }
+    cacheDirectory = directory;
+    driverSignature = std::string(reinterpret_cast<const char*>(glGetString(GL_VENDOR))) + "|" +
+                      reinterpret_cast<const char*>(glGetString(GL_RENDERER)) + "|" +
+                      reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    stats.enabled = true;
+}
+
+GLuint compileShader(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    if (!shader) {
+        std::cerr << "Error creating shader!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    GLint status;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE) {
+        char buffer[512];
+        glGetShaderInfoLog(shader, 512, nullptr, buffer);
+        std::cerr << "Shader Compile Error: " << buffer << std::endl;
+    }
+    return shader;
+}
+
+GLuint createShaderProgram(const char* vertexSrc, const char* fragmentSrc) {
+    const GLenum types[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+    const char* const sources[] = { vertexSrc, fragmentSrc };
+    return createProgram(types, sources, 2);
+}
+
+GLuint createComputeProgram(const char* computeSrc) {
+    const GLenum types[] = { GL_COMPUTE_SHADER };
+    const char* const sources[] = { computeSrc };
+    return createProgram(types, sources, 1);
+}
+
+const ShaderCacheStats& getShaderCacheStats() {
+    return stats;
+}
@@ -0,0 +1,33 @@
+// shader_program.h
+// Shader compilation and program linking with an on-disk program binary cache.
+
+#ifndef SHADER_PROGRAM_H
+#define SHADER_PROGRAM_H
+
+#include <glad/glad.h>
+
+#include <string>
+
+struct ShaderCacheStats {
+    bool enabled = false;        // driver supports program binaries and the directory is usable
+    int programsCompiled = 0;    // compiled and linked from source
+    int programsFromCache = 0;   // loaded with glProgramBinary
+    int cacheWrites = 0;
+    double totalMilliseconds = 0.0; // time spent creating programs
+};
+
+// Enables the program binary cache in the given directory (created if missing).
+// Must be called with a current context; the cache key includes the driver's
+// vendor, renderer and version strings, so a driver update invalidates it.
+void initShaderProgramCache(const std::string& directory);
+
+GLuint compileShader(GLenum type, const char* source);
+
+// Both return a linked program, from the cache when a valid binary exists and
+// by compiling the sources otherwise.
+GLuint createShaderProgram(const char* vertexSrc, const char* fragmentSrc);
+GLuint createComputeProgram(const char* computeSrc);
+
+const ShaderCacheStats& getShaderCacheStats();
+
+#endif // SHADER_PROGRAM_H
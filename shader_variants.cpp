@@ -0,0 +1,59 @@
+// shader_variants.cpp
+// Variant source assembly and lazy linking.
+
+#include "shader_variants.h"
+
+#include "shader_program.h"
+
+std::string buildShaderVariantSource(const ShaderVariantSet& set, const char* body, uint32_t features) {
+    int version = set.glslVersion;
+    for (size_t i = 0; i < set.featureCount; ++i) {
+        if ((features & (1u << i)) && set.features[i].glslVersion > version)
+            version = set.features[i].glslVersion;
+    }
+    std::string source = "#version " + std::to_string(version) + " core\n";
+    for (size_t i = 0; i < set.featureCount; ++i) {
+        if (features & (1u << i))
+            source += std::string("#define ") + set.features[i].define + " 1\n";
+    }
+    if (set.commonBody)
+        source += set.commonBody;
+    source += body;
+    return source;
+}
+
+GLuint getShaderVariant(ShaderVariantSet& set, uint32_t features) {
+    std::map<uint32_t, GLuint>::const_iterator it = set.programs.find(features);
+    if (it != set.programs.end())
+        return it->second;
+    std::string vertexSource = buildShaderVariantSource(set, set.vertexBody, features);
+    std::string fragmentSource = buildShaderVariantSource(set, set.fragmentBody, features);
+    GLuint program = createShaderProgram(vertexSource.c_str(), fragmentSource.c_str());
+    GLuint frameBlock = glGetUniformBlockIndex(program, "Frame");
+    if (frameBlock != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, frameBlock, kFrameUniformBinding);
+    if (set.samplerCount > 0) {
+        GLint previous = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+        glUseProgram(program);
+        for (size_t i = 0; i < set.samplerCount; ++i) {
+            GLint location = glGetUniformLocation(program, set.samplers[i].name);
+            if (location >= 0)
+                glUniform1i(location, set.samplers[i].unit);
+        }
+        glUseProgram(static_cast<GLuint>(previous));
+    }
+    set.programs[features] = program;
+    return program;
+}
+
+void warmShaderVariants(ShaderVariantSet& set, const uint32_t* featureMasks, size_t count) {
+    for (size_t i = 0; i < count; ++i)
+        getShaderVariant(set, featureMasks[i]);
+}
+
+void destroyShaderVariants(ShaderVariantSet& set) {
+    for (const auto& entry : set.programs)
+        glDeleteProgram(entry.second);
+    set.programs.clear();
+}
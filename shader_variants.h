@@ -0,0 +1,58 @@
+// shader_variants.h
+// Feature permutations of a shader: each variant is the shared vertex/fragment
+// body compiled with a #version line and one #define per enabled feature, so
+// hot shaders specialise at compile time instead of branching on uniforms.
+
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+// Uniform block binding for the per-frame "Frame" block; every variant that
+// declares the block gets it bound here when linked.
+const GLuint kFrameUniformBinding = 0;
+
+// Sampler uniform given a fixed texture unit when a variant links (GLSL 3.30
+// has no layout(binding) for samplers). Variants without the uniform skip it.
+struct ShaderSamplerBinding {
+    const char* name;
+    GLint unit;
+};
+
+struct ShaderFeature {
+    const char* define;   // macro defined to 1 when the feature bit is set
+    int glslVersion;      // minimum #version the feature needs
+};
+
+struct ShaderVariantSet {
+    const char* name = "";
+    int glslVersion = 330;              // #version when no feature asks for more
+    const char* commonBody = nullptr;   // declarations shared by both stages, before each body
+    const char* vertexBody = nullptr;   // sources without a #version line
+    const char* fragmentBody = nullptr;
+    const ShaderFeature* features = nullptr; // bit i of a feature mask enables features[i]
+    size_t featureCount = 0;
+    const ShaderSamplerBinding* samplers = nullptr;
+    size_t samplerCount = 0;
+    std::map<uint32_t, GLuint> programs;     // linked variants by feature mask
+};
+
+// Assembles the source for one stage of a variant.
+std::string buildShaderVariantSource(const ShaderVariantSet& set, const char* body, uint32_t features);
+
+// Returns the program for the feature mask, linking it on first use (through
+// the program binary cache).
+GLuint getShaderVariant(ShaderVariantSet& set, uint32_t features);
+
+// Links the listed variants up front so the first frame that needs them does
+// not hitch.
+void warmShaderVariants(ShaderVariantSet& set, const uint32_t* featureMasks, size_t count);
+
+void destroyShaderVariants(ShaderVariantSet& set);
+
+#endif // SHADER_VARIANTS_H
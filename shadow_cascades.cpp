@@ -0,0 +1,195 @@
+// shadow_cascades.cpp
+// Cascade fitting, the far cascade cache and the shadow map render targets.
+
+#include "shadow_cascades.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// Blend between logarithmic (1) and uniform (0) cascade splits.
+const float kSplitLambda = 0.75f;
+
+// The cached cascade is padded by this fraction of its radius and moves in
+// steps of the padding, so any camera position within a step stays covered.
+const float kCachedCascadePadding = 0.25f;
+
+bool framebufferComplete(const char* what) {
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Shadow " << what << " framebuffer incomplete: 0x" << std::hex << status << std::dec << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void setDepthTextureParameters(GLenum target) {
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    // Outside the map counts as lit.
+    const float border[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    glTexParameterfv(target, GL_TEXTURE_BORDER_COLOR, border);
+    glTexParameteri(target, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(target, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+}
+
+float snap(float value, float step) {
+    return std::floor(value / step) * step;
+}
+
+} // namespace
+
+bool createShadowCascades(ShadowCascades& shadows, int size) {
+    shadows.size = size;
+    glGenTextures(1, &shadows.depthArray);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, shadows.depthArray);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, size, size, kShadowCascadeCount, 0,
+                 GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    setDepthTextureParameters(GL_TEXTURE_2D_ARRAY);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glGenTextures(1, &shadows.cacheTexture);
+    glBindTexture(GL_TEXTURE_2D, shadows.cacheTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    bool complete = true;
+    glGenFramebuffers(kShadowCascadeCount, shadows.layerFramebuffers);
+    for (int i = 0; i < kShadowCascadeCount; ++i) {
+        glBindFramebuffer(GL_FRAMEBUFFER, shadows.layerFramebuffers[i]);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadows.depthArray, 0, i);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        complete = framebufferComplete("cascade") && complete;
+    }
+    glGenFramebuffers(1, &shadows.cacheFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, shadows.cacheFramebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, shadows.cacheTexture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    complete = framebufferComplete("cache") && complete;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    shadows.cacheValid = false;
+    return complete;
+}
+
+void destroyShadowCascades(ShadowCascades& shadows) {
+    glDeleteFramebuffers(kShadowCascadeCount, shadows.layerFramebuffers);
+    glDeleteFramebuffers(1, &shadows.cacheFramebuffer);
+    glDeleteTextures(1, &shadows.depthArray);
+    glDeleteTextures(1, &shadows.cacheTexture);
+    shadows = ShadowCascades();
+}
+
+void fitShadowCascades(ShadowCascades& shadows, const glm::vec3& cameraPos, const glm::vec3& cameraFront,
+                       float fovY, float aspect, float nearPlane, float shadowDistance,
+                       const glm::vec3& lightDirection) {
+    const glm::vec3 front = glm::normalize(cameraFront);
+    const glm::vec3 up = std::fabs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    const glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), lightDirection, up);
+    const float tanY = std::tan(fovY * 0.5f);
+    const float tanX = tanY * aspect;
+    float sliceNear = nearPlane;
+    for (int i = 0; i < kShadowCascadeCount; ++i) {
+        const float t = static_cast<float>(i + 1) / kShadowCascadeCount;
+        const float logSplit = nearPlane * std::pow(shadowDistance / nearPlane, t);
+        const float uniformSplit = nearPlane + (shadowDistance - nearPlane) * t;
+        const float sliceFar = kSplitLambda * logSplit + (1.0f - kSplitLambda) * uniformSplit;
+        // Sphere around the slice, centered on the view axis: its radius does
+        // not change as the camera turns, so neither does the texel size. The
+        // cached cascade instead covers everything within shadowDistance of the
+        // camera, so turning the camera does not move it at all.
+        const float middle = (sliceNear + sliceFar) * 0.5f;
+        glm::vec3 worldCenter = cameraPos + front * middle;
+        float radius = std::max(glm::length(glm::vec3(sliceFar * tanX, sliceFar * tanY, sliceFar - middle)),
+                                glm::length(glm::vec3(sliceNear * tanX, sliceNear * tanY, middle - sliceNear)));
+        float step = 0.0f;
+        if (i == kShadowCachedCascade) {
+            worldCenter = cameraPos;
+            radius = shadowDistance * std::sqrt(1.0f + tanX * tanX + tanY * tanY);
+            step = radius * kCachedCascadePadding;
+            radius += step;
+        }
+        const float texelSize = 2.0f * radius / shadows.size;
+        step = std::max(texelSize, std::ceil(step / texelSize) * texelSize);
+        glm::vec3 center = glm::vec3(lightView * glm::vec4(worldCenter, 1.0f));
+        center.x = snap(center.x, step);
+        center.y = snap(center.y, step);
+        if (i == kShadowCachedCascade)
+            center.z = snap(center.z, step);
+        const glm::mat4 projection = glm::ortho(center.x - radius, center.x + radius, center.y - radius, center.y + radius,
+                                                -(center.z + radius + kShadowCasterReach), -(center.z - radius));
+        ShadowCascade& cascade = shadows.cascades[i];
+        cascade.viewProj = projection * lightView;
+        cascade.frustum = extractFrustum(cascade.viewProj);
+        cascade.splitDepth = sliceFar;
+        cascade.texelSize = texelSize;
+        sliceNear = sliceFar;
+    }
+}
+
+void invalidateShadowCache(ShadowCascades& shadows) {
+    shadows.cacheValid = false;
+    shadows.farLayerHasMovingCasters = false;
+}
+
+bool shadowCacheStale(ShadowCascades& shadows, const std::vector<uint64_t>& staticCasters) {
+    const glm::mat4& viewProj = shadows.cascades[kShadowCachedCascade].viewProj;
+    if (shadows.cacheValid && std::memcmp(&viewProj, &shadows.cachedViewProj, sizeof(glm::mat4)) == 0 &&
+        staticCasters == shadows.cachedCasters)
+        return false;
+    shadows.cacheValid = true;
+    shadows.cachedViewProj = viewProj;
+    shadows.cachedCasters = staticCasters;
+    ++shadows.cacheRenders;
+    return true;
+}
+
+void beginShadowPass(const ShadowCascades& shadows) {
+    glViewport(0, 0, shadows.size, shadows.size);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+}
+
+void bindShadowCascade(const ShadowCascades& shadows, int cascade) {
+    glBindFramebuffer(GL_FRAMEBUFFER, shadows.layerFramebuffers[cascade]);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void bindShadowCache(const ShadowCascades& shadows) {
+    glBindFramebuffer(GL_FRAMEBUFFER, shadows.cacheFramebuffer);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void endShadowPass() {
+    glDisable(GL_POLYGON_OFFSET_FILL);
+}
+
+void copyShadowCache(ShadowCascades& shadows) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, shadows.cacheFramebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, shadows.layerFramebuffers[kShadowCachedCascade]);
+    glBlitFramebuffer(0, 0, shadows.size, shadows.size, 0, 0, shadows.size, shadows.size, GL_DEPTH_BUFFER_BIT,
+                      GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, shadows.layerFramebuffers[kShadowCachedCascade]);
+    ++shadows.farLayerCopies;
+}
+
+glm::mat4 shadowReceiverMatrix(const ShadowCascade& cascade, const glm::mat4& view) {
+    // Clip space [-1, 1] to texture coordinates and depth [0, 1].
+    const glm::mat4 bias = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.5f)), glm::vec3(0.5f));
+    return bias * cascade.viewProj * glm::inverse(view);
+}
+
+void bindShadowMap(const ShadowCascades& shadows) {
+    glActiveTexture(GL_TEXTURE0 + kShadowMapTextureUnit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, shadows.depthArray);
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,93 @@
+// shadow_cascades.h
+// Cascaded shadow maps for the directional light. The near cascades are
+// redrawn every frame; the far cascade keeps a cached depth map of the static
+// casters, redrawn only when the cascade moves or its static casters change,
+// and gets the moving casters drawn over a copy of it.
+
+#ifndef SHADOW_CASCADES_H
+#define SHADOW_CASCADES_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "frustum.h"
+
+const int kShadowCascadeCount = 3;
+const int kShadowCachedCascade = kShadowCascadeCount - 1;
+
+// Texture unit of the sampler2DArrayShadow uShadowMap.
+const GLint kShadowMapTextureUnit = 7;
+
+// How far beyond a cascade, towards the light, casters still shadow it.
+const float kShadowCasterReach = 50.0f;
+
+struct ShadowCascade {
+    glm::mat4 viewProj = glm::mat4(1.0f);   // world -> light clip space
+    Frustum frustum;                        // light frustum, for caster culling
+    float splitDepth = 0.0f;                // view depth where the cascade ends
+    float texelSize = 0.0f;                 // world units per shadow map texel
+};
+
+struct ShadowCascades {
+    int size = 0;
+    GLuint depthArray = 0;                          // one depth layer per cascade, compare mode
+    GLuint layerFramebuffers[kShadowCascadeCount] = {};
+    GLuint cacheTexture = 0;                        // static casters of the far cascade
+    GLuint cacheFramebuffer = 0;
+    ShadowCascade cascades[kShadowCascadeCount];
+
+    // What the cache was drawn with.
+    bool cacheValid = false;
+    glm::mat4 cachedViewProj;
+    std::vector<uint64_t> cachedCasters;   // sorted caster ids
+    bool farLayerHasMovingCasters = false;  // the far layer differs from the cache
+
+    uint64_t cacheRenders = 0;
+    uint64_t farLayerCopies = 0;
+};
+
+// Creates the depth array, the cache and their framebuffers. Reports to
+// std::cerr and returns false when a framebuffer is incomplete.
+bool createShadowCascades(ShadowCascades& shadows, int size);
+void destroyShadowCascades(ShadowCascades& shadows);
+
+// Splits [nearPlane, shadowDistance] of the camera frustum between the
+// cascades and fits a light-space box around each slice. Boxes move in whole
+// texels so edges do not shimmer. The cached cascade surrounds the camera,
+// is padded and moves in coarse steps, so it stays put while the camera turns
+// or moves a little.
+void fitShadowCascades(ShadowCascades& shadows, const glm::vec3& cameraPos, const glm::vec3& cameraFront,
+                       float fovY, float aspect, float nearPlane, float shadowDistance,
+                       const glm::vec3& lightDirection);
+
+// True when the far cascade's cache must be redrawn: the cascade moved, or the
+// static casters inside it (sorted ids) differ from the cached ones. Records
+// the new state, so call it once per frame and redraw when it returns true.
+bool shadowCacheStale(ShadowCascades& shadows, const std::vector<uint64_t>& staticCasters);
+
+// Forgets the far cascade's cache, so the next frame with shadows redraws it.
+// For frames without shadows: casters can move and settle meanwhile without
+// the cached ids or the cascade changing.
+void invalidateShadowCache(ShadowCascades& shadows);
+
+// Binds a cascade layer (or the cache) for drawing and clears its depth.
+// beginShadowPass sets the viewport and slope-scaled depth bias;
+// endShadowPass turns the bias off. The caller restores its framebuffer.
+void beginShadowPass(const ShadowCascades& shadows);
+void bindShadowCascade(const ShadowCascades& shadows, int cascade);
+void bindShadowCache(const ShadowCascades& shadows);
+void endShadowPass();
+
+// Copies the cache into the far layer and leaves that layer bound, ready for
+// the moving casters.
+void copyShadowCache(ShadowCascades& shadows);
+
+// Maps view-space positions to shadow map coordinates and depth of a cascade.
+glm::mat4 shadowReceiverMatrix(const ShadowCascade& cascade, const glm::mat4& view);
+
+void bindShadowMap(const ShadowCascades& shadows);
+
+#endif // SHADOW_CASCADES_H
@@ -0,0 +1,136 @@
+// shape_registry.cpp
+// Shape lookup and creation, reference counting and the inertia cache.
+
+#include "shape_registry.h"
+
+namespace {
+
+// Entries are tagged through the shape's user index; -1 is Bullet's default.
+RegisteredShape* findEntry(ShapeRegistry& registry, btCollisionShape* shape) {
+    const int index = shape->getUserIndex();
+    if (index < 0 || static_cast<size_t>(index) >= registry.entries.size() ||
+        registry.entries[index].shape != shape)
+        return nullptr;
+    return &registry.entries[index];
+}
+
+// The shape already registered for key, with one more reference, or null.
+btCollisionShape* acquireExisting(ShapeRegistry& registry, const ShapeKey& key) {
+    ++registry.stats.lookups;
+    std::unordered_map<ShapeKey, uint32_t, ShapeKeyHash>::const_iterator it = registry.lookup.find(key);
+    if (it == registry.lookup.end())
+        return nullptr;
+    RegisteredShape& entry = registry.entries[it->second];
+    ++entry.references;
+    return entry.shape;
+}
+
+void addShape(ShapeRegistry& registry, const ShapeKey& key, btCollisionShape* shape) {
+    uint32_t index;
+    if (!registry.freeEntries.empty()) {
+        index = registry.freeEntries.back();
+        registry.freeEntries.pop_back();
+    } else {
+        index = static_cast<uint32_t>(registry.entries.size());
+        registry.entries.push_back(RegisteredShape());
+    }
+    RegisteredShape& entry = registry.entries[index];
+    entry.key = key;
+    entry.shape = shape;
+    entry.references = 1;
+    entry.inertias.clear();
+    shape->setUserIndex(static_cast<int>(index));
+    registry.lookup[key] = index;
+    ++registry.stats.shapes;
+    ++registry.stats.shapesCreated;
+}
+
+} // namespace
+
+size_t ShapeKeyHash::operator()(const ShapeKey& key) const {
+    // FNV-1a over the raw bits; only exactly equal parameters share a shape.
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&key);
+    size_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < sizeof(ShapeKey); ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+btBoxShape* acquireBoxShape(ShapeRegistry& registry, const btVector3& halfExtents) {
+    ShapeKey key;
+    key.type = ShapeType::Box;
+    key.params[0] = static_cast<float>(halfExtents.x());
+    key.params[1] = static_cast<float>(halfExtents.y());
+    key.params[2] = static_cast<float>(halfExtents.z());
+    if (btCollisionShape* shape = acquireExisting(registry, key))
+        return static_cast<btBoxShape*>(shape);
+    btBoxShape* shape = new btBoxShape(halfExtents);
+    addShape(registry, key, shape);
+    return shape;
+}
+
+btSphereShape* acquireSphereShape(ShapeRegistry& registry, btScalar radius) {
+    ShapeKey key;
+    key.type = ShapeType::Sphere;
+    key.params[0] = static_cast<float>(radius);
+    if (btCollisionShape* shape = acquireExisting(registry, key))
+        return static_cast<btSphereShape*>(shape);
+    btSphereShape* shape = new btSphereShape(radius);
+    addShape(registry, key, shape);
+    return shape;
+}
+
+btStaticPlaneShape* acquirePlaneShape(ShapeRegistry& registry, const btVector3& normal, btScalar constant) {
+    ShapeKey key;
+    key.type = ShapeType::StaticPlane;
+    key.params[0] = static_cast<float>(normal.x());
+    key.params[1] = static_cast<float>(normal.y());
+    key.params[2] = static_cast<float>(normal.z());
+    key.params[3] = static_cast<float>(constant);
+    if (btCollisionShape* shape = acquireExisting(registry, key))
+        return static_cast<btStaticPlaneShape*>(shape);
+    btStaticPlaneShape* shape = new btStaticPlaneShape(normal, constant);
+    addShape(registry, key, shape);
+    return shape;
+}
+
+void releaseShape(ShapeRegistry& registry, btCollisionShape* shape) {
+    RegisteredShape* entry = findEntry(registry, shape);
+    if (!entry || --entry->references > 0)
+        return;
+    registry.lookup.erase(entry->key);
+    registry.freeEntries.push_back(static_cast<uint32_t>(entry - registry.entries.data()));
+    delete entry->shape;
+    entry->shape = nullptr;
+    entry->inertias.clear();
+    --registry.stats.shapes;
+}
+
+btVector3 shapeLocalInertia(ShapeRegistry& registry, btCollisionShape* shape, btScalar mass) {
+    btVector3 inertia(0, 0, 0);
+    RegisteredShape* entry = findEntry(registry, shape);
+    if (!entry) {
+        shape->calculateLocalInertia(mass, inertia);
+        return inertia;
+    }
+    ++registry.stats.inertiaLookups;
+    for (const ShapeInertia& cached : entry->inertias) {
+        if (cached.mass == mass)
+            return cached.inertia;
+    }
+    shape->calculateLocalInertia(mass, inertia);
+    ++registry.stats.inertiaComputations;
+    ShapeInertia cached;
+    cached.mass = mass;
+    cached.inertia = inertia;
+    entry->inertias.push_back(cached);
+    return inertia;
+}
+
+void clearShapeRegistry(ShapeRegistry& registry) {
+    for (RegisteredShape& entry : registry.entries)
+        delete entry.shape;
+    registry = ShapeRegistry();
+}
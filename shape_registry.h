@@ -0,0 +1,80 @@
+// shape_registry.h
+// Shared, reference-counted collision shapes. A shape is looked up by its
+// type and parameters, so every body of the same size uses one btCollisionShape
+// (Bullet never writes to a shape during simulation), and each shape caches
+// the local inertia it has computed per mass.
+
+#ifndef SHAPE_REGISTRY_H
+#define SHAPE_REGISTRY_H
+
+#include <btBulletDynamicsCommon.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+enum class ShapeType : uint32_t {
+    Box,            // params: half extents
+    Sphere,         // params: radius
+    StaticPlane     // params: normal, plane constant
+};
+
+struct ShapeKey {
+    ShapeType type = ShapeType::Box;
+    float params[4] = {};
+    bool operator==(const ShapeKey& other) const {
+        return std::memcmp(this, &other, sizeof(ShapeKey)) == 0;
+    }
+};
+
+struct ShapeKeyHash {
+    size_t operator()(const ShapeKey& key) const;
+};
+
+struct ShapeInertia {
+    btScalar mass;
+    btVector3 inertia;
+};
+
+struct RegisteredShape {
+    ShapeKey key;
+    btCollisionShape* shape = nullptr;   // null while the slot is free
+    int references = 0;
+    std::vector<ShapeInertia> inertias;  // per mass; bodies use a handful of masses
+};
+
+struct ShapeRegistryStats {
+    size_t shapes = 0;                  // live shapes
+    uint64_t shapesCreated = 0;
+    uint64_t lookups = 0;               // acquires, including the ones that created
+    uint64_t inertiaComputations = 0;
+    uint64_t inertiaLookups = 0;
+};
+
+struct ShapeRegistry {
+    std::vector<RegisteredShape> entries;    // a shape's user index is its entry
+    std::vector<uint32_t> freeEntries;
+    std::unordered_map<ShapeKey, uint32_t, ShapeKeyHash> lookup;
+    ShapeRegistryStats stats;
+};
+
+// Return the shape for the parameters, creating it on first use, with one
+// more reference the caller owns.
+btBoxShape* acquireBoxShape(ShapeRegistry& registry, const btVector3& halfExtents);
+btSphereShape* acquireSphereShape(ShapeRegistry& registry, btScalar radius);
+btStaticPlaneShape* acquirePlaneShape(ShapeRegistry& registry, const btVector3& normal, btScalar constant);
+
+// Drops a reference; the shape is deleted with its last one. Shapes not made
+// by the registry are ignored.
+void releaseShape(ShapeRegistry& registry, btCollisionShape* shape);
+
+// calculateLocalInertia, computed once per (shape, mass).
+btVector3 shapeLocalInertia(ShapeRegistry& registry, btCollisionShape* shape, btScalar mass);
+
+// Deletes every shape regardless of references. The bodies using them must be
+// gone already.
+void clearShapeRegistry(ShapeRegistry& registry);
+
+#endif // SHAPE_REGISTRY_H
@@ -0,0 +1,55 @@
+// sphere_impostor.cpp
+// Quad setup and instanced submission for ray-cast sphere impostors.
+
+#include "sphere_impostor.h"
+
+#include <cstddef>
+
+SphereImpostorRenderer createSphereImpostorRenderer() {
+    // Triangle strip corners in [-1, 1]; the vertex shader sizes and orients them.
+    const float corners[] = {
+        -1.0f, -1.0f,    1.0f, -1.0f,    -1.0f,  1.0f,    1.0f,  1.0f
+    };
+    SphereImpostorRenderer renderer;
+    glGenVertexArrays(1, &renderer.VAO);
+    glGenBuffers(1, &renderer.quadVBO);
+    glGenBuffers(1, &renderer.instanceVBO);
+    glBindVertexArray(renderer.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, renderer.quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), reinterpret_cast<void*>(0));
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, renderer.instanceVBO);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(SphereInstance),
+                          reinterpret_cast<void*>(offsetof(SphereInstance, centerRadius)));
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(SphereInstance),
+                          reinterpret_cast<void*>(offsetof(SphereInstance, color)));
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(1, 1);
+    glVertexAttribDivisor(2, 1);
+    glBindVertexArray(0);
+    return renderer;
+}
+
+void destroySphereImpostorRenderer(SphereImpostorRenderer& renderer) {
+    glDeleteVertexArrays(1, &renderer.VAO);
+    glDeleteBuffers(1, &renderer.quadVBO);
+    glDeleteBuffers(1, &renderer.instanceVBO);
+    renderer = SphereImpostorRenderer();
+}
+
+void drawSphereImpostors(SphereImpostorRenderer& renderer, const std::vector<SphereInstance>& instances) {
+    if (instances.empty())
+        return;
+    GLsizeiptr count = static_cast<GLsizeiptr>(instances.size());
+    glBindBuffer(GL_ARRAY_BUFFER, renderer.instanceVBO);
+    if (count > renderer.instanceCapacity)
+        renderer.instanceCapacity = count * 2;
+    // Orphan the previous frame's storage so the driver does not stall on it.
+    glBufferData(GL_ARRAY_BUFFER, renderer.instanceCapacity * sizeof(SphereInstance), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(SphereInstance), instances.data());
+    glBindVertexArray(renderer.VAO);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(count));
+    glBindVertexArray(0);
+}
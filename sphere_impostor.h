@@ -0,0 +1,31 @@
+// sphere_impostor.h
+// Ray-cast sphere impostors: one camera-facing quad per sphere, with the exact
+// sphere surface and depth resolved in the fragment shader.
+
+#ifndef SPHERE_IMPOSTOR_H
+#define SPHERE_IMPOSTOR_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+#include "sphere_lod.h"
+
+struct SphereImpostorRenderer {
+    GLuint VAO = 0;
+    GLuint quadVBO = 0;
+    GLuint instanceVBO = 0;
+    GLsizeiptr instanceCapacity = 0; // in instances
+};
+
+// Creates the shared corner quad and the per-instance attribute layout.
+// Instances use the same SphereInstance layout as the LOD mesh path.
+SphereImpostorRenderer createSphereImpostorRenderer();
+void destroySphereImpostorRenderer(SphereImpostorRenderer& renderer);
+
+// Uploads the instances and draws them all with one instanced call. The caller
+// binds the impostor program and sets its uProjection uniform; the view matrix
+// comes from the Frame uniform block.
+void drawSphereImpostors(SphereImpostorRenderer& renderer, const std::vector<SphereInstance>& instances);
+
+#endif // SPHERE_IMPOSTOR_H
@@ -0,0 +1,106 @@
+// sphere_lod.cpp
+// Icosphere LOD chain generation and LOD selection.
+
+#include "sphere_lod.h"
+
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// Screen radius (in pixels) at which each level stops being fine enough.
+// A sphere uses the finest level whose threshold it reaches.
+const float kLodMinScreenRadius[kSphereLodCount] = { 0.0f, 6.0f, 18.0f, 48.0f };
+
+struct IcosphereBuilder {
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    std::unordered_map<uint64_t, uint32_t> midpointCache;
+
+    uint32_t midpoint(uint32_t a, uint32_t b) {
+        uint64_t key = a < b ? (static_cast<uint64_t>(a) << 32) | b
+                             : (static_cast<uint64_t>(b) << 32) | a;
+        auto it = midpointCache.find(key);
+        if (it != midpointCache.end())
+            return it->second;
+        uint32_t index = static_cast<uint32_t>(positions.size());
+        positions.push_back(glm::normalize((positions[a] + positions[b]) * 0.5f));
+        midpointCache.emplace(key, index);
+        return index;
+    }
+};
+
+// Builds a unit icosphere with the given number of subdivisions. Normals equal
+// positions on a unit sphere.
+MeshData buildIcosphere(unsigned int subdivisions) {
+    const float t = (1.0f + std::sqrt(5.0f)) * 0.5f;
+    IcosphereBuilder builder;
+    // V = 10 * 4^n + 2, F = 20 * 4^n
+    size_t finalVertexCount = 10 * (static_cast<size_t>(1) << (2 * subdivisions)) + 2;
+    size_t finalIndexCount = 60 * (static_cast<size_t>(1) << (2 * subdivisions));
+    builder.positions.reserve(finalVertexCount);
+    builder.indices.reserve(finalIndexCount);
+    const glm::vec3 base[12] = {
+        glm::vec3(-1,  t,  0), glm::vec3( 1,  t,  0), glm::vec3(-1, -t,  0), glm::vec3( 1, -t,  0),
+        glm::vec3( 0, -1,  t), glm::vec3( 0,  1,  t), glm::vec3( 0, -1, -t), glm::vec3( 0,  1, -t),
+        glm::vec3( t,  0, -1), glm::vec3( t,  0,  1), glm::vec3(-t,  0, -1), glm::vec3(-t,  0,  1)
+    };
+    for (const glm::vec3& p : base)
+        builder.positions.push_back(glm::normalize(p));
+    const uint32_t baseFaces[60] = {
+        0, 11, 5,   0, 5, 1,    0, 1, 7,    0, 7, 10,   0, 10, 11,
+        1, 5, 9,    5, 11, 4,   11, 10, 2,  10, 7, 6,   7, 1, 8,
+        3, 9, 4,    3, 4, 2,    3, 2, 6,    3, 6, 8,    3, 8, 9,
+        4, 9, 5,    2, 4, 11,   6, 2, 10,   8, 6, 7,    9, 8, 1
+    };
+    builder.indices.assign(baseFaces, baseFaces + 60);
+    std::vector<uint32_t> next;
+    next.reserve(finalIndexCount);
+    for (unsigned int level = 0; level < subdivisions; ++level) {
+        next.clear();
+        builder.midpointCache.clear();
+        for (size_t i = 0; i < builder.indices.size(); i += 3) {
+            uint32_t v0 = builder.indices[i];
+            uint32_t v1 = builder.indices[i + 1];
+            uint32_t v2 = builder.indices[i + 2];
+            uint32_t a = builder.midpoint(v0, v1);
+            uint32_t b = builder.midpoint(v1, v2);
+            uint32_t c = builder.midpoint(v2, v0);
+            const uint32_t tris[12] = { v0, a, c,   v1, b, a,   v2, c, b,   a, b, c };
+            next.insert(next.end(), tris, tris + 12);
+        }
+        builder.indices.swap(next);
+    }
+    MeshData mesh;
+    mesh.normals = builder.positions;
+    mesh.positions.swap(builder.positions);
+    mesh.indices.swap(builder.indices);
+    return mesh;
+}
+
+} // namespace
+
+void addSphereLodMeshes(SphereLodChain& chain, MeshArena& arena) {
+    static const char* const names[kSphereLodCount] = {
+        "icosphere L0", "icosphere L1", "icosphere L2", "icosphere L3"
+    };
+    for (int level = 0; level < kSphereLodCount; ++level)
+        chain.levels[level] = addMeshToArena(arena, names[level], buildIcosphere(static_cast<unsigned int>(level)));
+}
+
+float projectedSphereRadius(float radius, float distance, float pixelsPerUnit) {
+    if (distance <= radius)
+        return 1e9f; // camera inside or touching the sphere
+    return radius * pixelsPerUnit / distance;
+}
+
+int selectSphereLod(float screenRadiusPixels, float lodBias) {
+    float r = screenRadiusPixels * lodBias;
+    for (int level = kSphereLodCount - 1; level > 0; --level) {
+        if (r >= kLodMinScreenRadius[level])
+            return level;
+    }
+    return 0;
+}
@@ -0,0 +1,39 @@
+// sphere_lod.h
+// Icosphere level-of-detail chain and screen-size LOD selection for spheres.
+
+#ifndef SPHERE_LOD_H
+#define SPHERE_LOD_H
+
+#include <glm/glm.hpp>
+
+#include "mesh_arena.h"
+
+// Number of icosphere subdivision levels kept in the chain (0 = 20 triangles).
+const int kSphereLodCount = 4;
+
+// --- Per-instance data for impostors ---
+// Spheres are rotation invariant, so a center, a radius and a color are all
+// the GPU needs per body.
+struct SphereInstance {
+    glm::vec4 centerRadius; // xyz = world-space center, w = radius
+    glm::vec3 color;
+};
+
+// Arena ranges of every LOD level, coarsest first.
+struct SphereLodChain {
+    MeshRange levels[kSphereLodCount];
+};
+
+// Builds unit-radius icospheres with 0..kSphereLodCount-1 subdivisions and adds
+// them to the arena. Call before uploadMeshArena.
+void addSphereLodMeshes(SphereLodChain& chain, MeshArena& arena);
+
+// Projected radius in pixels of a sphere of the given world radius at the
+// given view distance. pixelsPerUnit is projection[1][1] * viewportHeight / 2.
+float projectedSphereRadius(float radius, float distance, float pixelsPerUnit);
+
+// Picks a level from the projected screen radius. lodBias scales the radius
+// before the lookup (> 1 favours finer levels, < 1 coarser ones).
+int selectSphereLod(float screenRadiusPixels, float lodBias);
+
+#endif // SPHERE_LOD_H